@@ -0,0 +1,337 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/* solitaire-bench
+
+Times the game's hot paths, so a change to the rendering or rule code can be compared against
+the numbers from before it.  Built by "make bench", which also runs it:
+
+	solitaire-bench [--json FILE] [--time SECS] [--filter TEXT]
+
+Each benchmark runs its operation in batches for --time seconds (default 0.25) and reports
+ns/op, the 50th, 90th and 99th percentile of the per-batch ns/op, and heap allocations per op
+(operator new only; what GTK or cairo malloc directly isn't seen).  Results go to stdout and, as
+JSON, to --json (default bench.json).
+
+The Stack, shuffle and saved-game benchmarks need no display.  The CardPane and Animation ones
+(HitTest, NewGame, ShuffleDeck, a drag frame with its motion events applied one by one and
+coalesced, rendering at 100% and 200%, switching scales and the win's trails into a wxMemoryDC) need wx's GUI up; where that fails, e.g. no X display, they're skipped and
+marked so in the JSON.  Run under xvfb-run to get them headless.
+
+This file compiles solitaire.cpp in, so it times exactly the classes the game uses.
+
+*/
+
+#define SOLITAIRE_BENCH
+#include "solitaire.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+//heap allocations are counted by solitaire.cpp's operator new, see allocations there
+
+class StackBench
+{
+public:
+	static void RecomputeBounds(Stack& s) { s.RecomputeBounds(); }
+};
+
+struct BenchResult
+{
+	std::string name;
+	unsigned long long ops;
+	double nsperop, p50, p90, p99, allocsperop;
+};
+
+std::vector<BenchResult> results;
+double benchtime = 0.25;
+std::string filter;
+
+#define BATCH 100  //ops per timed batch, each with its own prepared state
+
+//times op(i) for i in 0..BATCH-1 over and over, calling setup(i) for each before the batch's clock starts
+template<class S, class O> void Measure(const char *name, S setup, O op)
+{
+	if (!filter.empty() && strstr(name, filter.c_str()) == NULL) return;
+	typedef std::chrono::steady_clock clock;
+	std::vector<double> samples;
+	unsigned long long ops = 0, allocs = 0;
+	double total = 0;
+
+	for (int i=0; i<BATCH; i++) { setup(i); op(i); }  //warm up
+	clock::time_point start = clock::now();
+	while ((std::chrono::duration<double>(clock::now() - start).count() < benchtime | samples.size() < 20) & samples.size() < 100000) {
+		for (int i=0; i<BATCH; i++) setup(i);
+		unsigned long long a = allocations;
+		clock::time_point t0 = clock::now();
+		for (int i=0; i<BATCH; i++) op(i);
+		double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+		allocs += allocations - a;
+		samples.push_back(ns / BATCH);
+		total += ns;
+		ops += BATCH;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	BenchResult r;
+	r.name = name;
+	r.ops = ops;
+	r.nsperop = total / ops;
+	r.p50 = samples[samples.size() * 50 / 100];
+	r.p90 = samples[samples.size() * 90 / 100];
+	r.p99 = samples[samples.size() * 99 / 100];
+	r.allocsperop = (double) allocs / ops;
+	results.push_back(r);
+	printf("%-40s %10.1f ns/op  p50 %10.1f  p90 %10.1f  p99 %10.1f  %6.2f allocs/op\n",
+		name, r.nsperop, r.p50, r.p90, r.p99, r.allocsperop);
+	fflush(stdout);
+}
+
+void NoSetup(int) {}
+
+//a tableau as the game lays it out, with n cards
+Stack MakeTableau(int n)
+{
+	Stack s(50, 250, WIDTH, HEIGHT);
+	s.SetStaggered(true);
+	for (int i=0; i<n; i++) s.AddCard(Card(i, 0, 0));
+	return s;
+}
+
+//Stack and deal code, no display needed
+void StackBenchmarks()
+{
+	std::vector<Stack> stacks(BATCH);
+	std::vector<Card> run;
+	for (int i=0; i<12; i++) run.push_back(Card(20+i, 0, 0));
+
+	Measure("Stack::AddCard",
+		[&](int i) { stacks[i] = MakeTableau(6); },
+		[&](int i) { stacks[i].AddCard(Card(40, 0, 0)); });
+	Measure("Stack::AddCards (12-card run)",
+		[&](int i) { stacks[i] = MakeTableau(6); },
+		[&](int i) { stacks[i].AddCards(run); });
+	Measure("Stack::ExtractCards (12 of 18)",
+		[&](int i) { stacks[i] = MakeTableau(18); },
+		[&](int i) { stacks[i].ExtractCards(6); });
+	Measure("Stack::ExtractCards (recycle 24)",
+		[&](int i) { stacks[i] = MakeTableau(24); stacks[i].SetStaggered(false); },
+		[&](int i) { stacks[i].ExtractCards(0); });
+	std::vector<Stack> sources(BATCH);
+	Measure("Stack::Splice (12-card run)",
+		[&](int i) { stacks[i] = MakeTableau(6); sources[i] = MakeTableau(18); },
+		[&](int i) { stacks[i].Splice(sources[i], 6); });
+	Measure("Stack::Splice (recycle 24, reversed)",
+		[&](int i) { stacks[i] = MakeTableau(0); sources[i] = MakeTableau(24); },
+		[&](int i) { stacks[i].Splice(sources[i], 0, true); });
+	Stack s = MakeTableau(19);
+	Measure("Stack::RecomputeBounds (19 cards)", NoSetup,
+		[&](int) { StackBench::RecomputeBounds(s); });
+
+	unsigned char shuffled[NUMCARDS];
+	unsigned long long number = 0;
+	Measure("ShuffleCards", NoSetup,
+		[&](int) { ShuffleCards(number++, shuffled); });
+
+	Snapshot snapshot;
+	DealGame(snapshot.position, 1, 3);
+	snapshot.dealnumber = 1;
+	snapshot.wins = snapshot.losses = 0;
+	snapshot.won = false;
+	Measure("WriteSnapshot", NoSetup,
+		[&](int) { WriteSnapshot("bench.save", snapshot); });
+	Measure("ReadSnapshot", NoSetup,
+		[&](int) { ReadSnapshot("bench.save", snapshot); });
+	remove("bench.save");
+}
+
+class BenchApp : public wxApp
+{
+public:
+	bool OnInit() { return true; }
+};
+
+wxIMPLEMENT_APP_NO_MAIN(BenchApp);
+
+//CardPane, needs the GUI up
+void PaneBenchmarks(CardPane *pane)
+{
+	unsigned char shuffled[NUMCARDS];
+	Measure("CardPane::ShuffleDeck", NoSetup,
+		[&](int) { pane->ShuffleDeck(shuffled); });
+	unsigned long long number = 0;
+	Measure("CardPane::NewGame", NoSetup,
+		[&](int) { pane->NewGame(1, number++); });
+
+	//a grid of points and card-sized rectangles over the table, hitting and missing:
+	std::vector<wxPoint> points;
+	std::vector<wxRect> rects;
+	for (int y=0; y<8; y++)
+		for (int x=0; x<8; x++) {
+			points.push_back(wxPoint(25 + x*100, 80 + y*60));
+			rects.push_back(wxRect(10 + x*100, 60 + y*60, WIDTH, HEIGHT));
+		}
+	pane->NewGame(1, 1);
+	pane->FinishAnimation();  //the deal onto the stacks
+	Measure("CardPane::HitTest(x, y)", NoSetup,
+		[&](int i) { pane->HitTest(points[i % points.size()].x, points[i % points.size()].y); });
+	Measure("CardPane::HitTest(wxRect)", NoSetup,
+		[&](int i) { pane->HitTest(rects[i % rects.size()]); });
+
+	//a frame of a drag with a fast mouse, 8 motion events to the frame: moved to each one as they
+	//come, as before OnMotion coalesced them, and noted then moved to the last, as it does now
+	wxBitmap target(850, 700);
+	wxMemoryDC mdc(target);
+	int grabx = -1, graby = -1;
+	for (int y=0; y<TABLEHEIGHT; y+=2)
+		for (int x=0; x<TABLEWIDTH; x+=2)
+			if (pane->HitTest(x, y) == TABLEAU7) { grabx = x; graby = y; }
+	if (grabx != -1) {
+		wxMouseEvent down(wxEVT_LEFT_DOWN), motion(wxEVT_MOTION);
+		down.SetPosition(wxPoint(grabx - 10, graby - 10));
+		pane->OnLeftDown(down);
+		int frame = 0;
+		Measure("CardPane drag frame (8 motions, each applied)", NoSetup,
+			[&](int) {
+				for (int i=0; i<8; i++) {
+					motion.SetPosition(wxPoint(grabx - (frame*8 + i) % 300, graby + (frame*8 + i) % 200));
+					pane->OnMotion(motion);
+					pane->ApplyDrag();
+				}
+				frame++;
+				pane->Paint(mdc);
+			});
+		Measure("CardPane drag frame (8 motions, coalesced)", NoSetup,
+			[&](int) {
+				for (int i=0; i<8; i++) {
+					motion.SetPosition(wxPoint(grabx - (frame*8 + i) % 300, graby + (frame*8 + i) % 200));
+					pane->OnMotion(motion);
+				}
+				frame++;
+				pane->ApplyDrag();
+				pane->Paint(mdc);
+			});
+		wxMouseEvent up(wxEVT_LEFT_UP);
+		up.SetPosition(wxPoint(grabx - 10, graby - 10));
+		pane->OnLeftUp(up);  //back where they came from
+	}
+	
+	Measure("CardPane::render (whole table)", NoSetup,
+		[&](int) { pane->render(mdc); });
+	
+	//the same table at 200%, as on a HiDPI screen: the faces come scaled from the cache
+	SetTableScale(2);
+	pane->LayOut();
+	{
+		wxBitmap big(1700, 1400);
+		wxMemoryDC bigdc(big);
+		Measure("CardPane::render (whole table, 200%)", NoSetup,
+			[&](int) { pane->render(bigdc); });
+		bigdc.SelectObject(wxNullBitmap);
+	}
+	double scales[2] = { 1, 2 };
+	Measure("SetTableScale (cached)", NoSetup,
+		[&](int i) { SetTableScale(scales[i & 1]); });
+	SetTableScale(1);
+	pane->LayOut();
+	
+	//the win cascade: 52 cards in the air, each step drawing them into the trails, however long the trails get
+	Animation anim;
+	Measure("Animation::Step (52 cards thrown, trails)",
+		[&](int i) {
+			if (i > 0) return;
+			anim.Clear();
+			for (int c=0; c<NUMCARDS; c++)
+				anim.Throw(Card(c, 400, 50 + c*4), (1 + c%3) * (c & 1 ? 1 : -1), -(c % 10), wxSize(850, 700));
+		},
+		[&](int) {
+			anim.Step([](const Card&, int) {}, &mdc);
+			anim.TakeDamage([](const wxRect&) {});
+		});
+	mdc.SelectObject(wxNullBitmap);
+}
+
+void JsonString(FILE *f, const std::string& s)
+{
+	fputc('"', f);
+	for (size_t i=0; i<s.size(); i++) {
+		if (s[i] == '"' | s[i] == '\\') fputc('\\', f);
+		fputc(s[i], f);
+	}
+	fputc('"', f);
+}
+
+bool WriteJson(const char *filename, bool display)
+{
+	FILE *f = fopen(filename, "w");
+	if (!f) return false;
+	fprintf(f, "{\n  \"benchmark\": \"solitaire-bench\",\n  \"display\": %s,\n  \"time_per_benchmark\": %g,\n  \"results\": [\n",
+		display ? "true" : "false", benchtime);
+	for (size_t i=0; i<results.size(); i++) {
+		BenchResult& r = results[i];
+		fprintf(f, "    {\"name\": ");
+		JsonString(f, r.name);
+		fprintf(f, ", \"ops\": %llu, \"ns_per_op\": %.2f, \"p50_ns\": %.2f, \"p90_ns\": %.2f, \"p99_ns\": %.2f, \"allocs_per_op\": %.3f}%s\n",
+			r.ops, r.nsperop, r.p50, r.p90, r.p99, r.allocsperop, i+1 < results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+	return fclose(f) == 0;
+}
+
+void usage()
+{
+	fprintf(stderr, "usage: solitaire-bench [--json FILE] [--time SECS] [--filter TEXT]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	std::string json = "bench.json";
+	for (int i=1; i<argc; i++) {
+		std::string arg = argv[i];
+		if (i+1 == argc) usage();
+		const char *val = argv[++i];
+		if (arg == "--json") json = val;
+		else if (arg == "--time") benchtime = atof(val);
+		else if (arg == "--filter") filter = val;
+		else usage();
+	}
+	int wxargc = 1;  //ours are parsed, wx gets none of them
+
+	StackBenchmarks();
+
+	bool display = wxEntryStart(wxargc, argv);
+	if (display) {
+		wxFrame *frame = new wxFrame(NULL, wxID_ANY, "solitaire-bench", wxDefaultPosition, wxSize(850,700));
+		frame->CreateStatusBar();
+		CardPane *pane = new CardPane(frame, wxID_ANY);
+		frame->Show(true);
+		PaneBenchmarks(pane);
+		frame->Destroy();
+		cardfaces.clear();
+		facecache.clear();
+		cardimages.clear();
+		wxEntryCleanup();
+	}
+	else printf("no display, CardPane benchmarks skipped (try xvfb-run)\n");
+
+	if (!WriteJson(json.c_str(), display)) {
+		fprintf(stderr, "solitaire-bench: can't write %s\n", json.c_str());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,175 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/* packcards
+
+Build tool, run on the build machine: reads the card xpms in cards.h and writes the sprite
+pack described in spritepack.h to stdout, as a C header holding one string literal.
+
+	packcards > cardsprites.h
+
+*/
+
+#include "cards.h"
+#include "spritepack.h"
+#include "../klondike.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+void fail(const char *msg, const char *detail)
+{
+	fprintf(stderr, "packcards: %s %s\n", msg, detail);
+	exit(1);
+}
+
+//an xpm color spec: #rrggbb or one of the X11 names the card images use
+unsigned long ParseColor(const char *spec)
+{
+	if (spec[0] == '#') return strtoul(spec+1, NULL, 16);
+	if (strcmp(spec, "black") == 0) return 0x000000;
+	if (strcmp(spec, "white") == 0) return 0xffffff;
+	if (strcmp(spec, "gray") == 0) return 0xbebebe;
+	if (strcmp(spec, "gainsboro") == 0) return 0xdcdcdc;
+	if (strcmp(spec, "LightGray") == 0) return 0xd3d3d3;
+	if (strcmp(spec, "DimGray") == 0) return 0x696969;
+	if (strncmp(spec, "gray", 4) == 0) {  //grayN, N percent
+		unsigned long v = (unsigned long) (atoi(spec+4) * 2.55 + 0.5);
+		return v << 16 | v << 8 | v;
+	}
+	fail("unknown color", spec);
+	return 0;
+}
+
+void Write16(std::vector<unsigned char>& out, int v)
+{
+	out.push_back(v & 0xff);
+	out.push_back(v >> 8 & 0xff);
+}
+
+void Write32(std::vector<unsigned char>& out, long v)
+{
+	Write16(out, v & 0xffff);
+	Write16(out, v >> 16 & 0xffff);
+}
+
+//run-length codes the indices as spritepack.h describes
+std::vector<unsigned char> Encode(const std::vector<unsigned char>& pixels)
+{
+	std::vector<unsigned char> data;
+	size_t i = 0, n = pixels.size();
+	while (i < n) {
+		size_t run = 1;
+		while (i+run < n && pixels[i+run] == pixels[i] && run < SPRITEPACK_REPEATS) run++;
+		if (run >= 2) {
+			data.push_back(run + 126);
+			data.push_back(pixels[i]);
+			i += run;
+			continue;
+		}
+		size_t start = i++;  //literals, up to the next repeat
+		while (i < n && i-start < SPRITEPACK_LITERALS && !(i+1 < n && pixels[i+1] == pixels[i])) i++;
+		data.push_back(i - start - 1);
+		data.insert(data.end(), pixels.begin()+start, pixels.begin()+i);
+	}
+	return data;
+}
+
+void PackCard(std::vector<unsigned char>& out, const char **xpm, int& width, int& height)
+{
+	int colors, cpp;
+	if (sscanf(xpm[0], "%d %d %d %d", &width, &height, &colors, &cpp) != 4) fail("bad xpm header", xpm[0]);
+
+	std::map<std::string, int> keys;  //xpm pixel key to palette index
+	std::map<unsigned long, int> rgbs;
+	std::vector<unsigned long> palette;
+	for (int i=1; i<=colors; i++) {
+		const char *c = strstr(xpm[i] + cpp, "c ");
+		if (!c) fail("no color in", xpm[i]);
+		unsigned long rgb = ParseColor(c + 2);
+		if (rgbs.find(rgb) == rgbs.end()) {
+			rgbs[rgb] = palette.size();
+			palette.push_back(rgb);
+		}
+		keys[std::string(xpm[i], cpp)] = rgbs[rgb];
+	}
+	if (palette.size() > 256) fail("more than 256 colors in", xpm[0]);
+
+	std::vector<unsigned char> pixels;
+	for (int y=0; y<height; y++) {
+		const char *row = xpm[1 + colors + y];
+		for (int x=0; x<width; x++) {
+			std::map<std::string, int>::iterator k = keys.find(std::string(row + x*cpp, cpp));
+			if (k == keys.end()) fail("unknown pixel in", row);
+			pixels.push_back(k->second);
+		}
+	}
+
+	Write16(out, palette.size());
+	for (unsigned i=0; i<palette.size(); i++) {
+		out.push_back(palette[i] >> 16 & 0xff);
+		out.push_back(palette[i] >> 8 & 0xff);
+		out.push_back(palette[i] & 0xff);
+	}
+	std::vector<unsigned char> data = Encode(pixels);
+	Write32(out, data.size());
+	out.insert(out.end(), data.begin(), data.end());
+}
+
+int main()
+{
+	//cardlist is in name order, the pack is in card id order:
+	const char **xpms[NUMCARDS] = {};
+	for (unsigned i=0; i<cardlist.size(); i++) {
+		int suit = 0;
+		if (cardlist[i].suit == "diamonds") suit = 1;
+		else if (cardlist[i].suit == "hearts") suit = 2;
+		else if (cardlist[i].suit == "spades") suit = 3;
+		xpms[MakeCard(suit, cardlist[i].rank)] = cardlist[i].image;
+	}
+
+	std::vector<unsigned char> sprites;
+	int width = 0, height = 0;
+	for (int id=0; id<NUMCARDS; id++) {
+		int w, h;
+		if (!xpms[id]) fail("missing card", "");
+		PackCard(sprites, xpms[id], w, h);
+		if (id > 0 && (w != width | h != height)) fail("card sizes differ", "");
+		width = w;
+		height = h;
+	}
+
+	std::vector<unsigned char> pack;
+	pack.push_back('C'); pack.push_back('P'); pack.push_back('K'); pack.push_back('1');
+	Write16(pack, width);
+	Write16(pack, height);
+	Write16(pack, NUMCARDS);
+	pack.insert(pack.end(), sprites.begin(), sprites.end());
+
+	printf("//generated by cards/packcards from the xpms in cards/cards.h, don't edit\n");
+	printf("//%d card faces, %dx%d, %d bytes\n\n", NUMCARDS, width, height, (int) pack.size());
+	printf("static const unsigned char cardsprites[] =\n\"");
+	for (size_t i=0; i<pack.size(); i++) {
+		unsigned char c = pack[i];
+		if (c >= 0x20 & c < 0x7f & c != '"' & c != '\\' & c != '?') putchar(c);
+		else printf("\\%03o", c);
+		if (i % 64 == 63) printf("\"\n\"");
+	}
+	printf("\";\n");
+	return 0;
+}
@@ -0,0 +1,95 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SPRITEPACK__
+#define __SPRITEPACK__
+
+#include <cstring>
+
+/* Sprite pack
+
+The card faces as one binary blob, made at build time by cards/packcards from the xpms in
+cards.h and compiled into the program as cardsprites.h.  Unpacking a face is a table lookup
+per pixel, with no text to parse.  Layout, all numbers little-endian:
+
+	"CPK1"
+	width, height, count                  16 bits each
+	count sprites, in klondike card id order, each:
+		colors                            16 bits
+		palette                           colors x 3 bytes, r g b
+		datasize                          32 bits
+		data                              datasize bytes of palette indices, run-length coded
+
+Run-length coding, by control byte c: c < 128 is followed by c+1 literal indices, c >= 128 by
+one index repeated c-126 times.
+
+*/
+
+#define SPRITEPACK_LITERALS 128  //longest literal run
+#define SPRITEPACK_REPEATS 129   //longest repeat
+
+class SpritePack
+{
+public:
+	SpritePack(const unsigned char *data)
+	{
+		pack = data;
+		count = 0;
+		if (pack[0] != 'C' | pack[1] != 'P' | pack[2] != 'K' | pack[3] != '1') return;
+		width = Read16(pack+4);
+		height = Read16(pack+6);
+		count = Read16(pack+8);
+	}
+
+	bool IsOk() { return count > 0; }
+	int GetWidth() { return width; }
+	int GetHeight() { return height; }
+	int GetCount() { return count; }
+
+	//fills rgb, width*height*3 bytes, with sprite index
+	void Unpack(int index, unsigned char *rgb)
+	{
+		const unsigned char *p = pack + 10;
+		for (int i=0; i<index; i++) {  //52 small hops, cheaper than keeping a table
+			p += 2 + Read16(p)*3;
+			p += 4 + Read32(p);
+		}
+		const unsigned char *palette = p + 2;
+		p += 2 + Read16(p)*3;
+		const unsigned char *end = p + 4 + Read32(p);
+		p += 4;
+
+		unsigned char *last = rgb + width*height*3;
+		while (p < end & rgb < last) {
+			int c = *p++;
+			if (c < 128) {
+				for (int i=0; i<=c & rgb < last; i++, rgb+=3) memcpy(rgb, palette + *p++ * 3, 3);
+			}
+			else {
+				const unsigned char *color = palette + *p++ * 3;
+				for (int i=0; i<c-126 & rgb < last; i++, rgb+=3) memcpy(rgb, color, 3);
+			}
+		}
+	}
+
+private:
+	static int Read16(const unsigned char *p) { return p[0] | p[1] << 8; }
+	static long Read32(const unsigned char *p) { return p[0] | p[1] << 8 | p[2] << 16 | (long) p[3] << 24; }
+
+	const unsigned char *pack;
+	int width, height, count;
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DEAL__
+#define __DEAL__
+
+#include "klondike.h"
+#include <stdint.h>
+
+/* Deal numbers
+
+Every deal has a 64-bit number, and the number alone decides the order of the deck, on every
+compiler and platform.  CardPane, solitaire-solve and any other tool deal through ShuffleCards,
+so "deal 123456" is the same table everywhere.  The mapping, which must never change:
+
+	1. The generator is SplitMix64, its state starting at the deal number.  Each step adds
+	   0x9e3779b97f4a7c15 to the state and returns the state mixed as:
+	       z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9
+	       z = (z ^ (z >> 27)) * 0x94d049bb133111eb
+	       z =  z ^ (z >> 31)
+	2. Each 64-bit output is used as two 32-bit numbers, high half first.
+	3. The deck starts as card ids 0..51 (see klondike.h).  For i from 51 down to 1, the next
+	   32-bit number r picks j = (r * (i+1)) >> 32, and cards i and j swap.
+	4. The result is in deck order, element 51 the top of the deck; Klondike::Deal lays it out.
+
+Step 3's multiply-shift is off from uniform by less than one part in 2^26, far below anything
+a game could show, and it's much faster than rejection sampling.  A deal takes 26 generator
+steps.
+
+Games of two decks shuffle ids 0..103 the same way, from 103 down; see ShuffleDecks.
+
+*/
+
+class DealRandom
+{
+public:
+	DealRandom(uint64_t dealnumber)
+	{
+		state = dealnumber;
+		last = 0;
+		half = false;
+	}
+
+	uint64_t Next64()
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	uint32_t Next32()
+	{
+		half = !half;
+		if (half) {
+			last = Next64();
+			return (uint32_t) (last >> 32);
+		}
+		return (uint32_t) last;
+	}
+
+private:
+	uint64_t state, last;
+	bool half;
+};
+
+inline void SwapCard(unsigned char *shuffled, int i, uint32_t r)
+{
+	int j = (int) (((uint64_t) r * (i+1)) >> 32);
+	unsigned char c = shuffled[i];
+	shuffled[i] = shuffled[j];
+	shuffled[j] = c;
+}
+
+//fills shuffled with card ids in deck order for a deal number, shuffled[51] is the top of the deck
+inline void ShuffleCards(uint64_t dealnumber, unsigned char shuffled[NUMCARDS])
+{
+	DealRandom r(dealnumber);
+	for (int i=0; i<NUMCARDS; i++) shuffled[i] = i;
+	for (int i=NUMCARDS-1; i>1; i-=2) {  //both halves of each output, same as Next32 twice
+		uint64_t z = r.Next64();
+		SwapCard(shuffled, i, (uint32_t) (z >> 32));
+		SwapCard(shuffled, i-1, (uint32_t) z);
+	}
+	SwapCard(shuffled, 1, r.Next32());  //51 swaps, the last one on its own
+}
+
+//the same shuffle of two or more decks, ids 0..decks*52-1; for one deck it's ShuffleCards
+inline void ShuffleDecks(uint64_t dealnumber, int decks, unsigned char *shuffled)
+{
+	DealRandom r(dealnumber);
+	int n = decks * NUMCARDS;
+	for (int i=0; i<n; i++) shuffled[i] = i;
+	for (int i=n-1; i>0; i--) SwapCard(shuffled, i, r.Next32());
+}
+
+//deals a game by number
+inline void DealGame(Klondike& k, uint64_t dealnumber, int numcarddraw)
+{
+	unsigned char shuffled[NUMCARDS];
+	ShuffleCards(dealnumber, shuffled);
+	k.Deal(shuffled, numcarddraw);
+}
+
+#endif
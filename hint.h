@@ -0,0 +1,204 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __HINT__
+#define __HINT__
+
+#include "klondike.h"
+#include "solver.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/* Hint engine
+
+Finds the best next move for a position on a thread of its own, so the caller never waits.
+Start hands it a position; it answers through the callback, on its thread, as many times as it
+improves on the answer:
+
+	1. at once, with QuickHint's pick, a ranking of the legal moves that takes microseconds,
+	   so there's always an answer well inside the 50ms a hint can take to show up;
+	2. then with the first move of a win, if the solver finds one within a growing node
+	   budget, or the news that there's no win to be had.
+
+Each answer carries the number Start returned.  Start or Cancel stop the search under way at
+the solver's next node, so an answer for an old position can still arrive, once, just after; the
+caller checks the number and drops it.
+
+*/
+
+enum {
+	HINT_NONE,     //no move worth making
+	HINT_GUESS,    //QuickHint's pick, or the best guess once the search gave up
+	HINT_WINS,     //the first move of a winning line
+	HINT_LOST      //the search found no win (SOLVER_UNSOLVABLE, see solver.h); the move is QuickHint's
+};
+
+struct Hint
+{
+	unsigned job;  //what Start returned
+	int kind;      //HINT_*
+	Move move;
+	unsigned long nodes;  //searched to get here
+};
+
+//how much QuickHint likes a move, 0 for not at all
+inline int HintScore(const Klondike& k, Move m)
+{
+	if (IsPile(m.from)) return 100;  //turn a card over, always
+	if (IsSuit(m.to)) return k.IsSafeUp(k.TopCard(m.from)) ? 90 : 40;
+	if (IsSuit(m.from)) return 0;  //back down from a suit stack, only as part of a plan
+	if (IsTableau(m.from) & IsTableau(m.to)) {
+		int n = k.GetNumberOfCards(m.from), pile = k.GetNumberOfCards(m.from - TABLEAU1 + PILE1);
+		if (m.count == n) {
+			if (pile > 0) return 70 + pile;  //uncovers a pile, the bigger the better
+			return CardRank(k.GetCards(m.from)[0]) == 13 ? 0 : 20;  //a king to another space is pointless
+		}
+		unsigned char under = k.GetCards(m.from)[n - m.count - 1];
+		return k.SuitFor(under) != -1 ? 50 : 0;  //a partial run, only to free the card under it
+	}
+	if (m.from == PLAY & IsTableau(m.to)) return 30;
+	return 10;  //the deck
+}
+
+//the best-looking legal move by HintScore, count 0 if none is worth making
+inline Move QuickHint(const Klondike& k)
+{
+	Move list[MAXMOVES];
+	int n = k.GenerateMoves(list);
+	Move best = { 0, 0, 0, 0 };
+	int bestscore = 0;
+	for (int i=0; i<n; i++) {
+		int score = HintScore(k, list[i]);
+		if (score > bestscore) {
+			bestscore = score;
+			best = list[i];
+		}
+	}
+	return best;
+}
+
+#define HINT_FIRSTNODES 20000    //the first search, about a tenth of a second
+#define HINT_MAXNODES 1000000    //the last, each one ten times the one before
+#define HINT_MEMORY (32*1024*1024)
+
+class HintEngine
+{
+public:
+	HintEngine(std::function<void(const Hint&)> answer) : solver(HINT_FIRSTNODES, HINT_MEMORY)
+	{
+		callback = answer;
+		job = 0;
+		pending = false;
+		quit = false;
+		stop = false;
+		solver.SetStop(&stop);
+		worker = std::thread(&HintEngine::Run, this);
+	}
+
+	~HintEngine()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			quit = true;
+			stop = true;
+		}
+		wake.notify_one();
+		worker.join();
+	}
+
+	//stops whatever is under way and starts on k, returns the number the answers will carry
+	unsigned Start(const Klondike& k)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		position = k;
+		pending = true;
+		stop = true;
+		wake.notify_one();
+		return ++job;
+	}
+
+	//stops the search under way, if any, without starting another
+	void Cancel()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		job++;
+		pending = false;
+		stop = true;
+	}
+
+private:
+	void Run()
+	{
+		for (;;) {
+			Klondike k;
+			unsigned mine;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				wake.wait(guard, [this]() { return pending | quit; });
+				if (quit) return;
+				k = position;
+				mine = job;
+				pending = false;
+				stop = false;
+			}
+			Search(k, mine);
+		}
+	}
+
+	void Search(const Klondike& k, unsigned mine)
+	{
+		Hint h;
+		h.job = mine;
+		h.move = QuickHint(k);
+		h.kind = h.move.count ? HINT_GUESS : HINT_NONE;
+		h.nodes = 0;
+		callback(h);
+
+		for (unsigned long budget=HINT_FIRSTNODES; budget<=HINT_MAXNODES; budget*=10) {
+			solver.SetNodeLimit(budget);
+			int result = solver.Solve(k);
+			if (stop) return;
+			h.nodes += solver.GetNodes();
+			if (result == SOLVER_SOLVED) {
+				if (solver.GetSolution().empty()) return;  //already won
+				h.kind = HINT_WINS;
+				h.move = solver.GetSolution()[0];
+				callback(h);
+				return;
+			}
+			if (result == SOLVER_UNSOLVABLE) {
+				h.kind = HINT_LOST;
+				callback(h);
+				return;
+			}
+		}
+	}
+
+	std::function<void(const Hint&)> callback;
+	Solver solver;
+	std::thread worker;
+
+	std::mutex lock;  //guards the rest
+	std::condition_variable wake;
+	Klondike position;
+	unsigned job;
+	bool pending, quit;
+	std::atomic<bool> stop;
+};
+
+#endif
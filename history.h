@@ -0,0 +1,316 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __HISTORY__
+#define __HISTORY__
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <stdint.h>
+
+/* Game history
+
+Every game that ends, won or given up for a new deal, as one 32-byte record appended to a file
+that's never rewritten, only added to.  The file starts with a 128-byte header that holds the
+totals over all the records, kept up as each one is appended, so the statistics are there the
+moment the file is opened however many games it holds.  Layout, numbers little-endian:
+
+	header:
+		"HIS1"                        4 bytes
+		record size                   4, 32
+		records counted               8, how many of the records the totals cover
+		totals for draw 1, draw 3     7 x 8 each: games, wins, moves, milliseconds played,
+		                              cards on the suit stacks, current and best winning streak
+	records, oldest first:
+		time                          8, seconds since 1970 when the game ended
+		deal number                   8
+		milliseconds played           4
+		moves                         4
+		draw, result, suit cards      1 each; result is HISTORY_WON or HISTORY_LOST
+		source                        1, HISTORY_PLAYER or HISTORY_SIMULATION
+		reserved                      4, zero
+
+The header is rewritten after each append, so if a program stops in between, or another one
+appended without it, the totals fall behind the records; Open counts the ones past them in.
+Only one program should append at a time.
+
+Query streams a range of records a buffer at a time and finds where a range of dates starts by
+binary search, relying on records going in in time order (a clock set back breaks that, and
+makes date queries miss some records, though never the totals).
+
+*/
+
+#define HISTORY_HEADERSIZE 128
+#define HISTORY_RECORDSIZE 32
+#define HISTORY_BUFFER 256  //records read at a time by Query
+
+enum {
+	HISTORY_LOST,  //given up, a new game dealt before the win
+	HISTORY_WON
+};
+
+enum {
+	HISTORY_PLAYER,
+	HISTORY_SIMULATION
+};
+
+struct GameRecord
+{
+	int64_t time;
+	uint64_t dealnumber;
+	uint32_t duration;  //milliseconds
+	uint32_t moves;
+	int draw, result, foundation, source;  //foundation, the cards on the suit stacks at the end
+};
+
+struct HistoryStats
+{
+	uint64_t games, wins, moves, duration, foundation;
+	uint64_t streak, beststreak;  //wins in a row
+};
+
+class GameHistory
+{
+public:
+	GameHistory()
+	{
+		file = NULL;
+		count = 0;
+		memset(stats, 0, sizeof(stats));
+	}
+
+	~GameHistory()
+	{
+		Close();
+	}
+
+	//opens filename, making it if it isn't there, and brings the totals up to date
+	bool Open(const std::string& filename)
+	{
+		Close();
+		file = fopen(filename.c_str(), "r+b");
+		if (!file) {
+			file = fopen(filename.c_str(), "w+b");
+			if (!file) return false;
+			count = 0;
+			memset(stats, 0, sizeof(stats));
+			if (!WriteHeader()) {
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		unsigned char header[HISTORY_HEADERSIZE];
+		if (fread(header, 1, HISTORY_HEADERSIZE, file) != HISTORY_HEADERSIZE
+				|| memcmp(header, "HIS1", 4) != 0 || Get(header+4, 4) != HISTORY_RECORDSIZE) {
+			Close();  //not ours, leave it be
+			return false;
+		}
+		count = Get(header+8, 8);
+		const unsigned char *p = header+16;
+		for (int d=0; d<2; d++) {
+			HistoryStats& s = stats[d];
+			s.games = Get(p, 8); s.wins = Get(p+8, 8); s.moves = Get(p+16, 8); s.duration = Get(p+24, 8);
+			s.foundation = Get(p+32, 8); s.streak = Get(p+40, 8); s.beststreak = Get(p+48, 8);
+			p += 56;
+		}
+
+		uint64_t records = Records();
+		if (count > records) {  //totals ahead of the records, a truncated file: count them all again
+			count = 0;
+			memset(stats, 0, sizeof(stats));
+		}
+		if (count < records) {
+			Query(count, records, [this](const GameRecord& r) { Add(r); });
+			count = records;
+			WriteHeader();
+		}
+		return true;
+	}
+
+	void Close()
+	{
+		if (file) fclose(file);
+		file = NULL;
+	}
+
+	bool IsOpen() const { return file != NULL; }
+
+	//adds a game to the end of the file and the totals
+	bool Append(const GameRecord& r)
+	{
+		if (!file) return false;
+		unsigned char rec[HISTORY_RECORDSIZE];
+		Encode(r, rec);
+		if (fseek(file, HISTORY_HEADERSIZE + count * HISTORY_RECORDSIZE, SEEK_SET) != 0
+				|| fwrite(rec, 1, HISTORY_RECORDSIZE, file) != HISTORY_RECORDSIZE)
+			return false;
+		Add(r);
+		count++;
+		return WriteHeader();
+	}
+
+	//the totals for a draw, 1 or 3
+	const HistoryStats& GetStats(int draw) const { return stats[draw == 3]; }
+
+	uint64_t GetCount() const { return count; }
+
+	//calls f(const GameRecord&) for records first to last-1, in order; returns how many it read
+	template<class F> uint64_t Query(uint64_t first, uint64_t last, F f)
+	{
+		if (!file) return 0;
+		unsigned char buf[HISTORY_BUFFER * HISTORY_RECORDSIZE];
+		uint64_t n = 0;
+		if (last > Records()) last = Records();
+		if (first >= last || fseek(file, HISTORY_HEADERSIZE + first * HISTORY_RECORDSIZE, SEEK_SET) != 0) return 0;
+		while (first + n < last) {
+			size_t want = last - first - n < HISTORY_BUFFER ? (size_t) (last - first - n) : HISTORY_BUFFER;
+			size_t got = fread(buf, HISTORY_RECORDSIZE, want, file);
+			for (size_t i=0; i<got; i++) {
+				GameRecord r;
+				Decode(buf + i*HISTORY_RECORDSIZE, r);
+				f(r);
+			}
+			n += got;
+			if (got < want) break;
+		}
+		return n;
+	}
+
+	//calls f(const GameRecord&) for the games ended from time from up to, not including, time to,
+	//of one draw, or both for draw 0; returns how many it called f for
+	template<class F> uint64_t QueryTime(int64_t from, int64_t to, int draw, F f)
+	{
+		uint64_t matched = 0;
+		bool done = false;
+		uint64_t first = FindTime(from), last = Records();
+		while (first < last & !done) {
+			uint64_t end = first + HISTORY_BUFFER < last ? first + HISTORY_BUFFER : last;
+			Query(first, end, [&](const GameRecord& r) {
+				if (r.time >= to) done = true;
+				if (!done & (draw == 0 | r.draw == draw)) {
+					f(r);
+					matched++;
+				}
+			});
+			first = end;
+		}
+		return matched;
+	}
+
+private:
+	//records in the file, including any the totals don't cover yet
+	uint64_t Records()
+	{
+		if (!file || fseek(file, 0, SEEK_END) != 0) return 0;
+		long size = ftell(file);
+		return size < HISTORY_HEADERSIZE ? 0 : (size - HISTORY_HEADERSIZE) / HISTORY_RECORDSIZE;
+	}
+
+	//the first record ended at or after time t, by binary search
+	uint64_t FindTime(int64_t t)
+	{
+		uint64_t lo = 0, hi = Records();
+		while (lo < hi) {
+			uint64_t mid = lo + (hi - lo) / 2;
+			unsigned char rec[8];
+			if (fseek(file, HISTORY_HEADERSIZE + mid * HISTORY_RECORDSIZE, SEEK_SET) != 0
+					|| fread(rec, 1, 8, file) != 8)
+				return hi;
+			if ((int64_t) Get(rec, 8) < t) lo = mid + 1;
+			else hi = mid;
+		}
+		return lo;
+	}
+
+	void Add(const GameRecord& r)
+	{
+		HistoryStats& s = stats[r.draw == 3];
+		s.games++;
+		s.moves += r.moves;
+		s.duration += r.duration;
+		s.foundation += r.foundation;
+		if (r.result == HISTORY_WON) {
+			s.wins++;
+			s.streak++;
+			if (s.streak > s.beststreak) s.beststreak = s.streak;
+		}
+		else s.streak = 0;
+	}
+
+	bool WriteHeader()
+	{
+		unsigned char header[HISTORY_HEADERSIZE];
+		memset(header, 0, HISTORY_HEADERSIZE);
+		memcpy(header, "HIS1", 4);
+		Put(header+4, HISTORY_RECORDSIZE, 4);
+		Put(header+8, count, 8);
+		unsigned char *p = header+16;
+		for (int d=0; d<2; d++) {
+			const HistoryStats& s = stats[d];
+			Put(p, s.games, 8); Put(p+8, s.wins, 8); Put(p+16, s.moves, 8); Put(p+24, s.duration, 8);
+			Put(p+32, s.foundation, 8); Put(p+40, s.streak, 8); Put(p+48, s.beststreak, 8);
+			p += 56;
+		}
+		return fseek(file, 0, SEEK_SET) == 0
+			&& fwrite(header, 1, HISTORY_HEADERSIZE, file) == HISTORY_HEADERSIZE
+			&& fflush(file) == 0;
+	}
+
+	static void Encode(const GameRecord& r, unsigned char *rec)
+	{
+		Put(rec, (uint64_t) r.time, 8);
+		Put(rec+8, r.dealnumber, 8);
+		Put(rec+16, r.duration, 4);
+		Put(rec+20, r.moves, 4);
+		rec[24] = (unsigned char) r.draw;
+		rec[25] = (unsigned char) r.result;
+		rec[26] = (unsigned char) r.foundation;
+		rec[27] = (unsigned char) r.source;
+		Put(rec+28, 0, 4);
+	}
+
+	static void Decode(const unsigned char *rec, GameRecord& r)
+	{
+		r.time = (int64_t) Get(rec, 8);
+		r.dealnumber = Get(rec+8, 8);
+		r.duration = (uint32_t) Get(rec+16, 4);
+		r.moves = (uint32_t) Get(rec+20, 4);
+		r.draw = rec[24];
+		r.result = rec[25];
+		r.foundation = rec[26];
+		r.source = rec[27];
+	}
+
+	static void Put(unsigned char *p, uint64_t v, int bytes)
+	{
+		for (int i=0; i<bytes; i++) p[i] = (unsigned char) (v >> 8*i);
+	}
+
+	static uint64_t Get(const unsigned char *p, int bytes)
+	{
+		uint64_t v = 0;
+		for (int i=0; i<bytes; i++) v |= (uint64_t) p[i] << 8*i;
+		return v;
+	}
+
+	FILE *file;
+	uint64_t count;  //records the totals cover
+	HistoryStats stats[2];  //draw 1, draw 3
+};
+
+#endif
@@ -0,0 +1,372 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __KLONDIKE__
+#define __KLONDIKE__
+
+#include <cstring>
+#include <stdint.h>
+
+/* Klondike engine
+
+A wx-free model of the game CardPane plays.  Each card is one byte, each stack is a fixed-size
+array, and the twenty stacks are numbered in the same arrangement as CardPane's stacks, so
+a position can be copied back and forth between the two.  Nothing here allocates, so moves can
+be applied and undone as fast as the solver and other tools need.
+
+Card ids are suit*13 + rank-1, with the suits in cards/cards.h order: 0 clubs, 1 diamonds,
+2 hearts, 3 spades.  A set of cards is a CardMask, bit id set for each card in it, so "which
+cards could land here" is one mask built from the rank and colour tables below, and testing a
+card against every destination at once is a single AND.
+
+*/
+
+enum {
+	DECK, PLAY,
+	SUIT1, SUIT2, SUIT3, SUIT4,
+	PILE1, PILE2, PILE3, PILE4, PILE5, PILE6, PILE7,
+	TABLEAU1, TABLEAU2, TABLEAU3, TABLEAU4, TABLEAU5, TABLEAU6, TABLEAU7,
+	NUMSTACKS
+};
+
+#define NUMCARDS 52
+#define STACKSIZE 24 //the most cards any one stack can hold, the deck right after the deal
+#define NOCARD 0xff  //the "top card" of an empty stack
+#define MAXMOVES 128 //more than the legal moves of any position
+#define MAXFINISH 256 //longer than any Finish, 52 cards up plus the flips and deck turns between
+
+inline int CardRank(unsigned char c) { return c % 13 + 1; }
+inline int CardSuit(unsigned char c) { return c / 13; }
+inline int CardColor(unsigned char c) { return (c / 13 == 1) | (c / 13 == 2); }  //0=black, 1=red
+inline unsigned char MakeCard(int suit, int rank) { return suit*13 + rank-1; }
+
+typedef uint64_t CardMask;
+
+#define SUITMASK 0x1fffULL        //the 13 cards of suit 0, shift by 13*suit for the others
+#define RANKMASK 0x8004002001ULL  //the aces, shift by rank-1 for the others
+#define REDMASK (SUITMASK << 13 | SUITMASK << 26)
+#define BLACKMASK (SUITMASK | SUITMASK << 39)
+
+inline CardMask CardBit(unsigned char c) { return (CardMask) 1 << c; }  //not for NOCARD
+inline CardMask SuitCards(int suit) { return SUITMASK << 13*suit; }
+inline CardMask RankCards(int rank) { return RANKMASK << (rank-1); }
+inline CardMask ColorCards(int color) { return color ? REDMASK : BLACKMASK; }
+
+inline bool IsSuit(int stack) { return stack >= SUIT1 & stack <= SUIT4; }
+inline bool IsPile(int stack) { return stack >= PILE1 & stack <= PILE7; }
+inline bool IsTableau(int stack) { return stack >= TABLEAU1 & stack <= TABLEAU7; }
+
+//card landing rules, top is NOCARD for an empty stack:
+inline bool TableauAccepts(unsigned char top, unsigned char card)
+{
+	if (top == NOCARD) return CardRank(card) == 13;  //only a king goes on an empty tableau
+	return CardRank(top) == CardRank(card) + 1 & CardColor(top) != CardColor(card);
+}
+
+inline bool SuitAccepts(unsigned char top, unsigned char card)
+{
+	if (top == NOCARD) return CardRank(card) == 1;
+	return CardSuit(top) == CardSuit(card) & CardRank(top) + 1 == CardRank(card);
+}
+
+//the same rules as masks: every card TableauAccepts on top
+inline CardMask TableauTakes(unsigned char top)
+{
+	if (top == NOCARD) return RankCards(13);
+	if (CardRank(top) == 1) return 0;
+	return RankCards(CardRank(top) - 1) & ColorCards(!CardColor(top));
+}
+
+//A move of count cards from one stack to another.  Transfers to or from the deck are
+//made one card at a time, so they reverse the order, as the deck clicks in CardPane do.
+//Four bytes, so a game's worth of them makes a cheap undo log; the inverse of a move is
+//the same move with from and to swapped.
+struct Move
+{
+	unsigned char from, to, count, flags;
+};
+
+#define MOVE_FLIP 1  //flags: a pile's top card turned over onto its tableau
+
+inline Move MakeMove(int from, int to, int count, int flags=0)
+{
+	Move m;
+	m.from = from; m.to = to; m.count = count; m.flags = flags;
+	return m;
+}
+
+inline Move Inverse(Move m)
+{
+	return MakeMove(m.to, m.from, m.count, m.flags);
+}
+
+class Klondike
+{
+public:
+	Klondike()
+	{
+		Clear();
+		draw = 1;
+	}
+
+	void Clear()
+	{
+		memset(size, 0, sizeof(size));
+	}
+
+	//deals the same layout as CardPane::NewGame, shuffled[51] being the top of the deck:
+	void Deal(const unsigned char shuffled[NUMCARDS], int numcarddraw)
+	{
+		Clear();
+		draw = numcarddraw;
+		int top = NUMCARDS;
+		for (int row=0; row<7; row++) {
+			cards[TABLEAU1+row][size[TABLEAU1+row]++] = shuffled[--top];
+			for (int p=row+1; p<7; p++) cards[PILE1+p][size[PILE1+p]++] = shuffled[--top];
+		}
+		memcpy(cards[DECK], shuffled, top);  //what's left, 24 cards
+		size[DECK] = top;
+	}
+
+	int GetNumberOfCards(int stack) const
+	{
+		return size[stack];
+	}
+
+	const unsigned char * GetCards(int stack) const
+	{
+		return cards[stack];
+	}
+
+	unsigned char TopCard(int stack) const
+	{
+		return size[stack] ? cards[stack][size[stack]-1] : NOCARD;
+	}
+
+	int GetDraw() const
+	{
+		return draw;
+	}
+
+	//sets a stack's cards, bottom first, for loading a position from somewhere else:
+	void SetCards(int stack, const unsigned char *ids, int n)
+	{
+		memcpy(cards[stack], ids, n);
+		size[stack] = n;
+	}
+
+	void SetDraw(int numcarddraw)
+	{
+		draw = numcarddraw;
+	}
+
+	bool IsWon() const
+	{
+		return size[SUIT1] == 13 & size[SUIT2] == 13 & size[SUIT3] == 13 & size[SUIT4] == 13;
+	}
+
+	//the move made by clicking the deck: draw, or recycle the play stack when the deck is empty
+	Move DeckMove() const
+	{
+		Move m;
+		if (size[DECK] > 0) {
+			m.from = DECK; m.to = PLAY;
+			m.count = size[DECK] < draw ? size[DECK] : draw;
+		}
+		else {
+			m.from = PLAY; m.to = DECK;
+			m.count = size[PLAY];
+		}
+		m.flags = 0;
+		return m;
+	}
+
+	bool IsLegal(Move m) const
+	{
+		if (m.from >= NUMSTACKS | m.to >= NUMSTACKS | m.from == m.to) return false;
+		if (m.count == 0 | m.count > size[m.from]) return false;
+
+		if (m.from == DECK | m.to == DECK) {
+			Move d = DeckMove();
+			return m.from == d.from & m.to == d.to & m.count == d.count;
+		}
+		if (IsPile(m.from))  //flip the top of a pile onto its empty tableau
+			return m.to == m.from - PILE1 + TABLEAU1 & m.count == 1 & size[m.to] == 0;
+		if (m.count > 1 & !IsTableau(m.from)) return false;
+
+		unsigned char card = cards[m.from][size[m.from] - m.count];
+		if (IsSuit(m.to))
+			return m.count == 1 & SuitAccepts(TopCard(m.to), card);
+		if (IsTableau(m.to))
+			return CanLand(m.to, card);
+		return false;
+	}
+
+	//the suit stack a card can go to, -1 if none.  Aces only consider the first empty suit stack.
+	int SuitFor(unsigned char card) const
+	{
+		for (int s=SUIT1; s<=SUIT4; s++)
+			if (SuitAccepts(TopCard(s), card)) return s;
+		return -1;
+	}
+
+	//a card is safe to put up when the opposite-colour cards one rank down are already up,
+	//so nothing left on the tableau could be built on it:
+	bool IsSafeUp(unsigned char card) const
+	{
+		int rank = CardRank(card);
+		if (rank <= 2) return true;
+		unsigned char built[4] = {0,0,0,0};
+		for (int s=SUIT1; s<=SUIT4; s++)
+			if (size[s] > 0) built[CardSuit(TopCard(s))] = size[s];
+		for (int suit=0; suit<4; suit++)
+			if (CardColor(MakeCard(suit,1)) != CardColor(card) && built[suit] < rank-1) return false;
+		return true;
+	}
+
+	//the cards that could land on a tableau now, none if it's empty over a pile
+	CardMask LandMask(int tableau) const
+	{
+		if (size[tableau] == 0 & size[tableau - TABLEAU1 + PILE1] > 0) return 0;
+		return TableauTakes(TopCard(tableau));
+	}
+
+	//the cards that could go up to a suit stack now: the next rank of each suit, aces while a stack is empty
+	CardMask UpMask() const
+	{
+		CardMask up = 0;
+		bool empty = false;
+		for (int s=SUIT1; s<=SUIT4; s++) {
+			if (size[s] == 0) empty = true;
+			else if (size[s] < 13) up |= CardBit(TopCard(s) + 1);
+		}
+		if (empty) up |= RankCards(1);
+		return up;
+	}
+
+	//fills moves with every legal move, up to MAXMOVES, and returns how many.  The order is
+	//flips, moves to the suit stacks, tableau runs, play to tableau, suit to tableau, then the deck.
+	int GenerateMoves(Move *moves) const
+	{
+		int n = 0;
+		CardMask land[7], anyland = 0;
+		for (int t=0; t<7; t++) {
+			if (size[TABLEAU1+t] == 0 & size[PILE1+t] > 0) AddMove(moves, n, PILE1+t, TABLEAU1+t, 1, MOVE_FLIP);
+			land[t] = LandMask(TABLEAU1+t);
+			anyland |= land[t];
+		}
+
+		CardMask up = UpMask();
+		if (size[PLAY] > 0 && (up & CardBit(TopCard(PLAY)))) AddMove(moves, n, PLAY, SuitFor(TopCard(PLAY)), 1);
+		for (int t=TABLEAU1; t<=TABLEAU7; t++)
+			if (size[t] > 0 && (up & CardBit(TopCard(t)))) AddMove(moves, n, t, SuitFor(TopCard(t)), 1);
+
+		//a card that lands nowhere costs one AND; only the rest look at the destinations
+		for (int from=TABLEAU1; from<=TABLEAU7; from++)
+			for (int i=0; i<size[from]; i++)
+				if (anyland & CardBit(cards[from][i])) AddLandings(moves, n, land, from, cards[from][i], size[from]-i);
+		if (size[PLAY] > 0 && (anyland & CardBit(TopCard(PLAY)))) AddLandings(moves, n, land, PLAY, TopCard(PLAY), 1);
+		for (int from=SUIT1; from<=SUIT4; from++)
+			if (size[from] > 0 && (anyland & CardBit(TopCard(from)))) AddLandings(moves, n, land, from, TopCard(from), 1);
+
+		Move d = DeckMove();
+		if (d.count > 0) AddMove(moves, n, d.from, d.to, d.count);
+		return n;
+	}
+
+	//with the deck empty and nothing face-down but piles waiting for their empty tableau, 
+	//the game can usually be played out without thinking: flip what can be flipped, put up 
+	//what can go up, and turn over the play stack when nothing else moves.  Fills moves 
+	//with that sequence and returns its length if it wins, -1 if it doesn't or the 
+	//position isn't that far along.
+	int Finish(Move *moves) const
+	{
+		if (size[DECK] > 0) return -1;
+		for (int t=0; t<7; t++)
+			if (size[PILE1+t] > 0 & size[TABLEAU1+t] > 0) return -1;
+
+		Klondike k = *this;
+		int n = 0, idle = 0;
+		while (!k.IsWon()) {
+			Move m = { 0, 0, 0, 0 };
+			for (int t=0; t<7 & m.count == 0; t++)
+				if (k.size[TABLEAU1+t] == 0 & k.size[PILE1+t] > 0) m = MakeMove(PILE1+t, TABLEAU1+t, 1, MOVE_FLIP);
+			CardMask up = k.UpMask();
+			for (int s=PLAY; s<=TABLEAU7 & m.count == 0; s++)
+				if ((s == PLAY | IsTableau(s)) && k.size[s] > 0 && (up & CardBit(k.TopCard(s))))
+					m = MakeMove(s, k.SuitFor(k.TopCard(s)), 1);
+			if (m.count == 0) {  //stuck but for the deck, and a whole turn through it hasn't helped:
+				if (k.size[DECK] + k.size[PLAY] == 0 | idle > k.size[DECK] + k.size[PLAY] + 1) return -1;
+				m = k.DeckMove();
+				idle++;
+			}
+			else idle = 0;
+			if (n == MAXFINISH) return -1;
+			moves[n++] = m;
+			k.Apply(m);
+		}
+		return n;
+	}
+
+	//neither Apply nor Undo check legality, see IsLegal:
+	void Apply(Move m)
+	{
+		Transfer(m.from, m.to, m.count);
+	}
+
+	void Undo(Move m)
+	{
+		Transfer(m.to, m.from, m.count);
+	}
+
+private:
+	//tableau landing, with the empty-tableau-over-a-pile check:
+	bool CanLand(int tableau, unsigned char card) const
+	{
+		if (size[tableau] == 0 & size[tableau - TABLEAU1 + PILE1] > 0) return false;
+		return TableauAccepts(TopCard(tableau), card);
+	}
+
+	static void AddMove(Move *moves, int& n, int from, int to, int count, int flags=0)
+	{
+		if (n == MAXMOVES) return;
+		moves[n++] = MakeMove(from, to, count, flags);
+	}
+
+	//a move to every tableau whose mask has card
+	static void AddLandings(Move *moves, int& n, const CardMask land[7], int from, unsigned char card, int count)
+	{
+		for (int t=0; t<7; t++)
+			if (TABLEAU1+t != from && (land[t] & CardBit(card))) AddMove(moves, n, from, TABLEAU1+t, count);
+	}
+
+	void Transfer(int from, int to, int count)
+	{
+		unsigned char *src = cards[from] + size[from] - count;
+		unsigned char *dst = cards[to] + size[to];
+		if (from == DECK | to == DECK)
+			for (int i=0; i<count; i++) dst[i] = src[count-1-i];
+		else
+			memcpy(dst, src, count);
+		size[from] -= count;
+		size[to] += count;
+	}
+
+	unsigned char cards[NUMSTACKS][STACKSIZE];
+	unsigned char size[NUMSTACKS];
+	int draw;
+};
+
+#endif
@@ -0,0 +1,426 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/* solitaire-rendercheck
+
+Paints a scripted set of tables offscreen, the way OnPaint does, times the frames and checks the
+pixels against golden images, so a change to the drawing (caching, clipping, scaling) can be
+measured and seen to draw the same table.  Built by "make rendercheck", which also runs it:
+
+	solitaire-rendercheck [--golden DIR] [--update | --timings] [--out DIR] [--frames N]
+	                      [--threshold N] [--tolerance F] [--json FILE]
+
+The tables, each set up through the same CardPane calls the game makes:
+
+	deal      deal 1, draw 1, just dealt
+	midgame   deal 1 after 40 of QuickHint's moves
+	deep      a 13-card run, king down to ace, on the first tableau
+	drag      deal 1 with the last tableau's top card picked up and dragged across the table
+	win       deal 1's win cascade, WINSTEPS animation steps in, trails and all
+	deal200   the fresh deal again at 200%
+
+Each is painted --frames times (default 50) into a wxMemoryDC through CardPane::Paint, cleared
+first as a paint event's background is; the win instead times each of its animation steps with
+the paint after it.  Per-frame milliseconds, median, 99th percentile and worst, go to stdout and,
+as JSON, to --json (default rendercheck.json).
+
+Then, in the window itself, the last tableau's top card is dragged for DRAGSECONDS by a mouse
+reporting DRAGHZ times a second, the window painting between events as it does on screen: once
+coalesced by OnMotion, and once with every event applied, as before the coalescing.  Motion
+events, paints a second and motion-to-paint latency, the performance overlay's numbers (see
+PaintStats), go to stdout and the JSON's drags.  They're timings only, nothing to compare.  So does
+LoadCardFaces' time to unpack the faces, as faces_ms.
+
+The last frame is then compared with DIR/NAME.png: a pixel differs when any channel is off by
+more than --threshold (default 16), and the table fails when more than --tolerance (default
+0.001) of its pixels differ.  A failure, or a missing golden, writes NAME.actual.png to --out
+(default .), with NAME.diff.png, the differing pixels in red over a faded copy, when there was
+a golden to compare, and the exit status is 1.  --update writes the goldens instead of comparing;
+with no DIR at all it stops before painting anything and says to run --update first.  --timings
+compares and writes nothing, for the frame and drag numbers alone on a machine without goldens
+("make rendertimings").
+
+Text and anti-aliasing follow the fonts and cairo of the machine, so the goldens belong to the
+CI box they were made on; see the README.  This file compiles solitaire.cpp in, as bench.cpp
+does.
+
+*/
+
+#define SOLITAIRE_BENCH
+#include "solitaire.cpp"
+#include "wx/image.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+#define WINSTEPS 90       //animation steps into the win cascade when it's compared
+#define MIDGAMEMOVES 40   //QuickHint moves into the midgame table
+#define DRAGSECONDS 1     //of each drag pacing run
+#define DRAGHZ 1000       //its mouse's motion events a second
+
+struct RenderResult
+{
+	std::string name;
+	int width, height, frames;
+	double p50, p99, worst;  //milliseconds per frame
+	unsigned long differing;  //pixels
+	const char *status;  //"match", "differ", "missing", "updated", "timed" or "error"
+};
+
+struct DragResult
+{
+	const char *name;  //"each" or "coalesced"
+	double motionrate, paintrate;  //a second
+	double latency, latencymax;  //milliseconds, motion to paint
+};
+
+std::vector<RenderResult> results;
+std::vector<DragResult> drags;
+std::string goldendir = "golden", outdir = ".";
+bool update = false, timings = false;
+int frames = 50, threshold = 16;
+double tolerance = 0.001;
+
+std::string PathIn(const std::string& dir, const std::string& file)
+{
+	return wxFileName(dir, file).GetFullPath().ToStdString();
+}
+
+//the pixels that differ by more than threshold, marked in red on diff
+unsigned long Compare(const wxImage& actual, const wxImage& golden, wxImage& diff)
+{
+	int w = actual.GetWidth(), h = actual.GetHeight();
+	diff = wxImage(w, h);
+	const unsigned char *a = actual.GetData(), *g = golden.GetData();
+	unsigned char *d = diff.GetData();
+	unsigned long differing = 0;
+	for (int i=0; i<w*h*3; i+=3) {
+		bool off = false;
+		for (int c=0; c<3; c++) off |= abs(a[i+c] - g[i+c]) > threshold;
+		if (off) {
+			d[i] = 255; d[i+1] = 0; d[i+2] = 0;
+			differing++;
+		}
+		else for (int c=0; c<3; c++) d[i+c] = (unsigned char) (192 + a[i+c] / 4);
+	}
+	return differing;
+}
+
+//checks target against its golden, or writes it, and fills in r's result
+void Check(const wxBitmap& target, RenderResult& r)
+{
+	if (timings) {
+		r.status = "timed";
+		return;
+	}
+	wxImage actual = target.ConvertToImage();
+	std::string golden = PathIn(goldendir, r.name + ".png");
+	if (update) {
+		r.status = actual.SaveFile(golden, wxBITMAP_TYPE_PNG) ? "updated" : "error";
+		return;
+	}
+	wxImage expected;
+	if (!wxFileExists(golden) || !expected.LoadFile(golden, wxBITMAP_TYPE_PNG)) r.status = "missing";
+	else if (expected.GetWidth() != actual.GetWidth() | expected.GetHeight() != actual.GetHeight()) {
+		r.status = "differ";
+		r.differing = (unsigned long) actual.GetWidth() * actual.GetHeight();
+	}
+	else {
+		wxImage diff;
+		r.differing = Compare(actual, expected, diff);
+		r.status = r.differing > tolerance * actual.GetWidth() * actual.GetHeight() ? "differ" : "match";
+		if (r.differing > 0) diff.SaveFile(PathIn(outdir, r.name + ".diff.png"), wxBITMAP_TYPE_PNG);
+	}
+	if (strcmp(r.status, "match") != 0) actual.SaveFile(PathIn(outdir, r.name + ".actual.png"), wxBITMAP_TYPE_PNG);
+}
+
+//times n frames of frame(dc) into a bitmap the pane's size, then checks the last one
+template<class F> void Render(CardPane *pane, const char *name, int n, F frame)
+{
+	typedef std::chrono::steady_clock clock;
+	wxSize size = pane->GetClientSize();
+	wxBitmap target(size.GetWidth(), size.GetHeight());
+	wxMemoryDC mdc(target);
+	mdc.SetFont(pane->GetFont());
+	mdc.SetBackground(wxBrush(pane->GetBackgroundColour()));
+	std::vector<double> samples;
+	for (int i=0; i<n; i++) {
+		clock::time_point t0 = clock::now();
+		mdc.Clear();
+		frame(mdc);
+		samples.push_back(std::chrono::duration<double, std::milli>(clock::now() - t0).count());
+	}
+	mdc.SelectObject(wxNullBitmap);
+
+	std::sort(samples.begin(), samples.end());
+	RenderResult r;
+	r.name = name;
+	r.width = size.GetWidth();
+	r.height = size.GetHeight();
+	r.frames = n;
+	r.differing = 0;
+	r.p50 = samples[samples.size() * 50 / 100];
+	r.p99 = samples[samples.size() * 99 / 100];
+	r.worst = samples.back();
+	Check(target, r);
+	results.push_back(r);
+	printf("%-10s %4dx%-4d %4d frames  p50 %7.3f ms  p99 %7.3f ms  worst %7.3f ms  %-8s",
+		name, r.width, r.height, n, r.p50, r.p99, r.worst, r.status);
+	if (strcmp(r.status, "differ") == 0) printf(" (%lu pixels)", r.differing);
+	printf("\n");
+	fflush(stdout);
+}
+
+//the table as a paint event draws it
+void Paint(CardPane *pane, const char *name)
+{
+	Render(pane, name, frames, [pane](wxDC& dc) { pane->Paint(dc); });
+}
+
+//sizes the table to w by h at scale, as Rescale would for that window
+void SizeTable(wxFrame *frame, CardPane *pane, int w, int h, double scale)
+{
+	frame->SetClientSize(w, h);
+	wxYield();  //the size events
+	SetTableScale(scale);
+	pane->LayOut();
+	pane->Refresh();
+}
+
+void MouseAt(CardPane *pane, wxEventType type, int x, int y)
+{
+	wxMouseEvent event(type);
+	event.SetPosition(wxPoint(x, y));
+	if (type == wxEVT_LEFT_DOWN) pane->OnLeftDown(event);
+	else if (type == wxEVT_MOTION) pane->OnMotion(event);
+	else pane->OnLeftUp(event);
+}
+
+//drags the card at grabx, graby for DRAGSECONDS, a motion event every 1/DRAGHZ s wandering left
+//and down and back, and wxYield after each for the paints and dragtimer; each applies every event
+//straight away, as OnMotion did before it coalesced them
+void DragPacing(CardPane *pane, int grabx, int graby, const char *name, bool each)
+{
+	typedef std::chrono::steady_clock clock;
+	MouseAt(pane, wxEVT_LEFT_DOWN, grabx, graby);
+	wxYield();
+	PaintStats& perf = pane->GetPaintStats();
+	perf.Start();
+	clock::time_point start = clock::now();
+	for (int i=0; i<DRAGHZ*DRAGSECONDS; i++) {
+		std::this_thread::sleep_until(start + std::chrono::microseconds(i * 1000000LL / DRAGHZ));
+		int step = i % 400;
+		MouseAt(pane, wxEVT_MOTION, grabx - std::min(step, 400 - step), graby + std::min(step, 400 - step) / 4);
+		if (each) pane->ApplyDrag();
+		wxYield();
+	}
+	perf.Publish();
+	MouseAt(pane, wxEVT_LEFT_UP, grabx, graby);  //back where it came from
+	wxYield();
+
+	DragResult d = { name, perf.motionrate, perf.paintrate, perf.latency, perf.latencymax };
+	drags.push_back(d);
+	printf("drag %-9s %5.0f motions/s  %5.0f paints/s  motion to paint %7.2f ms, worst %7.2f ms\n",
+		name, d.motionrate, d.paintrate, d.latency, d.latencymax);
+	fflush(stdout);
+}
+
+void RenderChecks(wxFrame *frame, CardPane *pane)
+{
+	SizeTable(frame, pane, TABLEWIDTH, TABLEHEIGHT, 1);
+
+	pane->NewGame(1, 1);
+	pane->FinishAnimation();  //the deal onto the stacks
+	Paint(pane, "deal");
+
+	Klondike k;
+	DealGame(k, 1, 1);
+	for (int i=0; i<MIDGAMEMOVES; i++) {
+		Move m = QuickHint(k);
+		if (m.count == 0) m = k.DeckMove();
+		if (m.count == 0) break;
+		k.Apply(m);
+	}
+	pane->LoadPosition(k);
+	Paint(pane, "midgame");
+
+	//the deal with its first tableau swapped for a king-to-ace run, red and black by turns;
+	//the cards it takes are found in the other stacks and moved to the deck
+	DealGame(k, 1, 1);
+	unsigned char run[13], rest[NUMCARDS];
+	int n = 0;
+	for (int i=0; i<13; i++) run[i] = (unsigned char) ((i & 1 ? 1 : 0) * 13 + 12 - i);  //suits 0 and 1, black and red
+	for (int s=0; s<NUMSTACKS; s++) {
+		int kept = 0;
+		unsigned char cards[NUMCARDS];
+		for (int i=0; i<k.GetNumberOfCards(s); i++) {
+			unsigned char c = k.GetCards(s)[i];
+			if (std::find(run, run+13, c) != run+13) continue;
+			if (s == TABLEAU1) rest[n++] = c;
+			else cards[kept++] = c;
+		}
+		if (s != TABLEAU1) k.SetCards(s, cards, kept);
+	}
+	unsigned char deck[NUMCARDS];
+	int decksize = k.GetNumberOfCards(DECK);
+	memcpy(deck, k.GetCards(DECK), decksize);
+	memcpy(deck + decksize, rest, n);
+	k.SetCards(DECK, deck, decksize + n);
+	k.SetCards(TABLEAU1, run, 13);
+	pane->LoadPosition(k);
+	Paint(pane, "deep");
+
+	//picks up the top card of the last tableau, found by hit testing down the table, and drags it
+	pane->NewGame(1, 1);
+	pane->FinishAnimation();
+	int grabx = -1, graby = -1;
+	for (int y=0; y<TABLEHEIGHT; y+=2)
+		for (int x=0; x<TABLEWIDTH; x+=2)
+			if (pane->HitTest(x, y) == TABLEAU7) { grabx = x; graby = y; }
+	if (grabx != -1) {
+		MouseAt(pane, wxEVT_LEFT_DOWN, grabx - 10, graby - 10);
+		MouseAt(pane, wxEVT_MOTION, grabx - 200, graby + 40);
+		MouseAt(pane, wxEVT_MOTION, grabx - 300, graby + 60);
+		pane->ApplyDrag();  //what the frame tick does, whatever the clock said in OnMotion
+	}
+	Paint(pane, "drag");
+	if (grabx != -1) {
+		MouseAt(pane, wxEVT_LEFT_UP, grabx - 10, graby - 10);  //back where it came from
+		DragPacing(pane, grabx - 10, graby - 10, "each", true);
+		DragPacing(pane, grabx - 10, graby - 10, "coalesced", false);
+	}
+
+	//every card on the suit stacks, then the cascade played a step a frame
+	k.Clear();
+	k.SetDraw(1);
+	for (int s=0; s<4; s++) {
+		unsigned char suit[13];
+		for (int i=0; i<13; i++) suit[i] = (unsigned char) (s*13 + i);
+		k.SetCards(SUIT1 + s, suit, 13);
+	}
+	pane->LoadPosition(k);
+	pane->StartCascade();
+	Render(pane, "win", WINSTEPS, [pane](wxDC& dc) {
+		pane->StepAnimation(1);
+		pane->Paint(dc);
+	});
+	pane->FinishAnimation();
+
+	SizeTable(frame, pane, 2*TABLEWIDTH, 2*TABLEHEIGHT, 2);
+	pane->NewGame(1, 1);
+	pane->FinishAnimation();
+	Paint(pane, "deal200");
+	SizeTable(frame, pane, TABLEWIDTH, TABLEHEIGHT, 1);
+}
+
+class RenderCheckApp : public wxApp
+{
+public:
+	bool OnInit() { return true; }
+};
+
+wxIMPLEMENT_APP_NO_MAIN(RenderCheckApp);
+
+bool WriteJson(const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (!f) return false;
+	fprintf(f, "{\n  \"benchmark\": \"solitaire-rendercheck\",\n  \"threshold\": %d,\n  \"tolerance\": %g,\n  \"faces_ms\": %.3f,\n  \"results\": [\n",
+		threshold, tolerance, facesms);
+	for (size_t i=0; i<results.size(); i++) {
+		RenderResult& r = results[i];
+		fprintf(f, "    {\"name\": \"%s\", \"width\": %d, \"height\": %d, \"frames\": %d, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"worst_ms\": %.4f, \"differing\": %lu, \"status\": \"%s\"}%s\n",
+			r.name.c_str(), r.width, r.height, r.frames, r.p50, r.p99, r.worst, r.differing, r.status, i+1 < results.size() ? "," : "");
+	}
+	fprintf(f, "  ],\n  \"drags\": [\n");
+	for (size_t i=0; i<drags.size(); i++) {
+		DragResult& d = drags[i];
+		fprintf(f, "    {\"name\": \"%s\", \"motions_per_s\": %.1f, \"paints_per_s\": %.1f, \"latency_ms\": %.3f, \"latency_worst_ms\": %.3f}%s\n",
+			d.name, d.motionrate, d.paintrate, d.latency, d.latencymax, i+1 < drags.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+	return fclose(f) == 0;
+}
+
+void usage()
+{
+	fprintf(stderr,
+		"usage: solitaire-rendercheck [options]\n"
+		"  --golden DIR      golden images (default golden)\n"
+		"  --update          write the goldens instead of comparing\n"
+		"  --timings         time the tables and drags, no goldens read or written\n"
+		"  --out DIR         where failures' images go (default .)\n"
+		"  --frames N        frames timed per table (default 50)\n"
+		"  --threshold N     channel difference a pixel may have (default 16)\n"
+		"  --tolerance F     fraction of pixels that may differ (default 0.001)\n"
+		"  --json FILE       results (default rendercheck.json)\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	std::string json = "rendercheck.json";
+	for (int i=1; i<argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--update") { update = true; continue; }
+		if (arg == "--timings") { timings = true; continue; }
+		if (i+1 == argc) usage();
+		const char *val = argv[++i];
+		if (arg == "--golden") goldendir = val;
+		else if (arg == "--out") outdir = val;
+		else if (arg == "--frames") frames = atoi(val);
+		else if (arg == "--threshold") threshold = atoi(val);
+		else if (arg == "--tolerance") tolerance = atof(val);
+		else if (arg == "--json") json = val;
+		else usage();
+	}
+	if (frames < 1 | update & timings) usage();
+	int wxargc = 1;  //ours are parsed, wx gets none of them
+	if (!update & !timings && !wxDirExists(goldendir)) {  //nothing to compare with, no goldens are shipped
+		fprintf(stderr, "solitaire-rendercheck: no goldens in %s; make them on this machine first with --update\n", goldendir.c_str());
+		return 1;
+	}
+
+	if (!wxEntryStart(wxargc, argv)) {
+		fprintf(stderr, "solitaire-rendercheck: no display (try xvfb-run)\n");
+		return 1;
+	}
+	wxInitAllImageHandlers();
+	if (update && !wxDirExists(goldendir)) wxMkdir(goldendir);
+	wxFrame *frame = new wxFrame(NULL, wxID_ANY, "solitaire-rendercheck");
+	frame->CreateStatusBar();
+	CardPane *pane = new CardPane(frame, wxID_ANY);
+	printf("card faces unpacked in %.3f ms\n", facesms);
+	frame->Show(true);
+	RenderChecks(frame, pane);
+	frame->Destroy();
+	cardfaces.clear();
+	facecache.clear();
+	cardimages.clear();
+	wxEntryCleanup();
+
+	bool failed = false;
+	for (size_t i=0; i<results.size(); i++) failed |= strcmp(results[i].status, "match") != 0 & strcmp(results[i].status, "updated") != 0 & strcmp(results[i].status, "timed") != 0;
+	if (!WriteJson(json.c_str())) {
+		fprintf(stderr, "solitaire-rendercheck: can't write %s\n", json.c_str());
+		return 1;
+	}
+	if (failed) fprintf(stderr, "solitaire-rendercheck: tables differ from the goldens in %s; the .actual.png and .diff.png files are in %s\n",
+		goldendir.c_str(), outdir.c_str());
+	return failed;
+}
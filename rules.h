@@ -0,0 +1,483 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __RULES__
+#define __RULES__
+
+#include "klondike.h"
+#include <cstring>
+
+/* Game rules as data
+
+A game is a Variant: a table of stacks, each described by a StackRule saying what kind of
+stack it is, what lands on it, what can be picked up off it and where it sits, plus callbacks
+for the few things a table can't say, the deal and the stock.  Klondike, FreeCell, Spider and
+Yukon are defined below; another game is another table of StackRules.
+
+Face-down cards live in a stack of their own, kind STACK_HIDDEN, under the stack that holds
+the face-up cards over them, as Klondike's piles sit under its tableaux.  A stack's hidden
+field names the one under it.  Either the player turns the next one up by clicking the empty
+stack, as in Klondike, or a variant with autoflip turns it up as soon as the stack empties.
+
+The Klondike table numbers its stacks the same as klondike.h, so CardPane, which lays itself
+out from the table, keeps the ids the engine, solver and saved games use.  A turn of the stock
+comes back from its callback as one-card moves, which CardPane makes on its own stacks.
+
+Table plays any variant, with the same kind of fixed arrays as Klondike.  Two decks are card
+ids 0..103, and CardFace folds them back to the 52 faces; every rule only looks at faces.
+
+*/
+
+#define MAXDECKS 2
+#define MAXTABLECARDS (NUMCARDS*MAXDECKS)
+#define MAXTABLESTACKS 32
+#define MAXCOLUMNS 10  //widest layout, Spider's
+#define MAXTABLEMOVES 2048  //more than the legal moves of any position of any variant
+
+#define MAXTURNMOVES MAXTABLECARDS  //one-card moves a turn of the stock can make
+
+#define MOVE_TURN 2  //flags: a click on the stock, whatever the variant does with it; from is the stock
+
+enum {
+	STACK_STOCK,       //turned by clicking it, see Variant::turn
+	STACK_WASTE,       //what the stock turned up
+	STACK_FOUNDATION,  //where the game is won
+	STACK_TABLEAU,
+	STACK_HIDDEN,      //face-down cards under a tableau
+	STACK_CELL         //a free cell
+};
+
+enum {  //what a stack builds on its top card
+	BUILD_NONE,           //nothing lands here
+	BUILD_UP_SUIT,        //one at a time, up in suit
+	BUILD_DOWN_ALTERNATE, //down, alternating colours
+	BUILD_DOWN_SUIT,      //down in suit
+	BUILD_DOWN_ANY,       //down, any suit
+	BUILD_ANY,            //anything, as far as the capacity goes
+	BUILD_COMPLETE        //a whole suit at once, king to ace, onto an empty stack
+};
+
+enum {  //what lands on the stack when it's empty
+	EMPTY_NONE,
+	EMPTY_ACE,
+	EMPTY_KING,
+	EMPTY_ANY
+};
+
+enum {  //what can be picked up off the stack
+	GRAB_NONE,
+	GRAB_TOP,      //the top card only
+	GRAB_RUN,      //cards that follow the stack's own build rule, down to the top
+	GRAB_SUITRUN,  //cards down in suit, down to the top
+	GRAB_FACEUP    //any card, with everything on it
+};
+
+struct StackRule
+{
+	const char *name;
+	int kind, build, empty, grab;
+	int capacity;      //most cards it holds, 0 for no limit
+	int column, row;   //where it's drawn, row 0 the top row, row 1 the tableaux
+	int hidden;        //the STACK_HIDDEN stack under it, -1 for none
+	bool staggered;
+};
+
+class Table;
+
+struct Variant
+{
+	const char *name;
+	int decks;
+	int numstacks;
+	int columns;
+	const StackRule *rules;
+	bool autoflip;   //a hidden card turns up as soon as the stack over it is empty
+	bool supermove;  //runs go only as far as the free cells and empty tableaux could carry them a card at a time
+	void (*deal)(Table& t, const unsigned char *shuffled);  //shuffled[decks*52-1] is the top
+	bool (*canturn)(const Table& t);  //whether a click on the stock does anything
+	int (*turn)(const Table& t, Move *moves);  //what it does, as one-card moves in order; returns how many
+};
+
+inline unsigned char CardFace(unsigned char c) { return c % NUMCARDS; }
+
+//whether card follows top in a build, both faces
+inline bool RuleBuilds(int build, unsigned char top, unsigned char card)
+{
+	switch (build) {
+		case BUILD_UP_SUIT: return SuitAccepts(top, card);
+		case BUILD_DOWN_ALTERNATE: return TableauAccepts(top, card);
+		case BUILD_DOWN_SUIT: return CardSuit(top) == CardSuit(card) & CardRank(top) == CardRank(card) + 1;
+		case BUILD_DOWN_ANY: return CardRank(top) == CardRank(card) + 1;
+	}
+	return false;
+}
+
+//whether a stack of size cards, top card top (NOCARD if empty), takes count cards with card at the bottom
+inline bool RuleAccepts(const StackRule& r, int size, unsigned char top, unsigned char card, int count)
+{
+	if (r.capacity > 0 & size + count > r.capacity) return false;
+	card = CardFace(card);
+	switch (r.build) {
+		case BUILD_NONE: return false;
+		case BUILD_COMPLETE: return top == NOCARD & count == 13 & CardRank(card) == 13;
+		case BUILD_UP_SUIT: if (count != 1) return false;
+	}
+	if (top == NOCARD) {
+		int rank = CardRank(card);
+		return r.empty == EMPTY_ANY | r.empty == EMPTY_ACE & rank == 1 | r.empty == EMPTY_KING & rank == 13;
+	}
+	return RuleBuilds(r.build, CardFace(top), card);
+}
+
+//whether the cards from index up can be picked up off a stack of n cards
+inline bool RuleGrabs(const StackRule& r, const unsigned char *cards, int n, int index)
+{
+	if (index < 0 | index >= n) return false;
+	int build = r.build;
+	switch (r.grab) {
+		case GRAB_NONE: return false;
+		case GRAB_TOP: return index == n-1;
+		case GRAB_FACEUP: return true;
+		case GRAB_SUITRUN: build = BUILD_DOWN_SUIT;
+	}
+	for (int i=index; i<n-1; i++)
+		if (!RuleBuilds(build, CardFace(cards[i]), CardFace(cards[i+1]))) return false;
+	return true;
+}
+
+class Table
+{
+public:
+	Table(const Variant& v)
+	{
+		variant = &v;
+		stock = -1;
+		for (int s=0; s<v.numstacks; s++)
+			if (v.rules[s].kind == STACK_STOCK) stock = s;
+		draw = 1;
+		Clear();
+	}
+
+	void Clear()
+	{
+		memset(size, 0, sizeof(size));
+	}
+
+	const Variant& GetVariant() const
+	{
+		return *variant;
+	}
+
+	int NumberOfCards() const
+	{
+		return variant->decks * NUMCARDS;
+	}
+
+	//deals shuffled, NumberOfCards of them, the last the top; draw is what a Klondike stock turns over
+	void Deal(const unsigned char *shuffled, int numcarddraw=1)
+	{
+		Clear();
+		draw = numcarddraw;
+		variant->deal(*this, shuffled);
+	}
+
+	int GetDraw() const
+	{
+		return draw;
+	}
+
+	void SetDraw(int numcarddraw)
+	{
+		draw = numcarddraw;
+	}
+
+	int GetNumberOfCards(int stack) const
+	{
+		return size[stack];
+	}
+
+	const unsigned char * GetCards(int stack) const
+	{
+		return cards[stack];
+	}
+
+	unsigned char TopCard(int stack) const
+	{
+		return size[stack] ? cards[stack][size[stack]-1] : NOCARD;
+	}
+
+	//for the deal callback, and to set a table up card by card:
+	void Push(int stack, unsigned char c)
+	{
+		cards[stack][size[stack]++] = c;
+	}
+
+	unsigned char Pop(int stack)
+	{
+		return cards[stack][--size[stack]];
+	}
+
+	int FoundationCards() const
+	{
+		int n = 0;
+		for (int s=0; s<variant->numstacks; s++)
+			if (variant->rules[s].kind == STACK_FOUNDATION) n += size[s];
+		return n;
+	}
+
+	bool IsWon() const
+	{
+		return FoundationCards() == NumberOfCards();
+	}
+
+	//the most cards a run can move onto stack to at once
+	int MaxRun(int to) const
+	{
+		if (!variant->supermove) return MAXTABLECARDS;
+		int cells = 0, spaces = 0;
+		for (int s=0; s<variant->numstacks; s++) {
+			if (size[s] > 0 | s == to) continue;
+			cells += variant->rules[s].kind == STACK_CELL;
+			spaces += variant->rules[s].kind == STACK_TABLEAU;
+		}
+		return (cells + 1) << spaces;
+	}
+
+	bool CanTurn() const
+	{
+		return stock != -1 && variant->canturn(*this);
+	}
+
+	//the stock's turn as one-card moves, see Variant::turn; only when CanTurn
+	int Turn(Move *moves) const
+	{
+		return variant->turn(*this, moves);
+	}
+
+	//whether count cards can go from one stack to another; a hidden card turns up with count 1
+	//onto the empty stack over it, and the stock is CanTurn's
+	bool CanMove(int from, int to, int count) const
+	{
+		const StackRule *r = variant->rules;
+		if (from == to | count <= 0 | count > size[from]) return false;
+		if (r[from].kind == STACK_HIDDEN)
+			return r[to].hidden == from & count == 1 & size[to] == 0 & !variant->autoflip;
+		if (!RuleGrabs(r[from], cards[from], size[from], size[from] - count)) return false;
+		return Lands(from, to, count);
+	}
+
+	//fills moves with every legal move, up to MAXTABLEMOVES, and returns how many: flips, runs
+	//from each stack in stack order, shortest first, then the stock
+	int GenerateMoves(Move *moves) const
+	{
+		const StackRule *r = variant->rules;
+		int n = 0;
+		for (int s=0; s<variant->numstacks; s++) {
+			int h = r[s].hidden;
+			if (h != -1 && size[s] == 0 & size[h] > 0 & !variant->autoflip) moves[n++] = MakeMove(h, s, 1, MOVE_FLIP);
+		}
+		for (int from=0; from<variant->numstacks; from++)
+			for (int count=1; count<=size[from] && RuleGrabs(r[from], cards[from], size[from], size[from] - count); count++)
+				for (int to=0; to<variant->numstacks; to++)
+					if (to != from && Lands(from, to, count)) moves[n++] = MakeMove(from, to, count);
+		if (CanTurn()) moves[n++] = MakeMove(stock, stock, 0, MOVE_TURN);
+		return n;
+	}
+
+	//makes a move, which must be legal
+	void Apply(Move m)
+	{
+		if (m.flags & MOVE_TURN) {
+			Move turn[MAXTURNMOVES];
+			int n = Turn(turn);
+			for (int i=0; i<n; i++) Push(turn[i].to, Pop(turn[i].from));
+		}
+		else {
+			memcpy(cards[m.to] + size[m.to], cards[m.from] + size[m.from] - m.count, m.count);
+			size[m.from] -= m.count;
+			size[m.to] += m.count;
+			int h = variant->rules[m.from].hidden;
+			if (variant->autoflip && h != -1 && size[m.from] == 0 & size[h] > 0) Push(m.from, Pop(h));
+		}
+	}
+
+private:
+	//the landing half of CanMove, the cards already known to come off from
+	bool Lands(int from, int to, int count) const
+	{
+		const StackRule& r = variant->rules[to];
+		if (r.hidden != -1 && size[to] == 0 & size[r.hidden] > 0) return false;  //turn the hidden card up first
+		if (count > 1 && count > MaxRun(to)) return false;
+		return RuleAccepts(r, size[to], TopCard(to), cards[from][size[from] - count], count);
+	}
+
+	const Variant *variant;
+	int stock;  //the STACK_STOCK stack, -1 for none
+	unsigned char cards[MAXTABLESTACKS][MAXTABLECARDS];
+	unsigned char size[MAXTABLESTACKS];
+	int draw;
+};
+
+//Klondike, in klondike.h's stack order:
+
+inline void KlondikeDeal(Table& t, const unsigned char *shuffled)
+{
+	int top = NUMCARDS;
+	for (int row=0; row<7; row++) {
+		t.Push(TABLEAU1+row, shuffled[--top]);
+		for (int p=row+1; p<7; p++) t.Push(PILE1+p, shuffled[--top]);
+	}
+	for (int i=0; i<top; i++) t.Push(DECK, shuffled[i]);
+}
+
+inline bool KlondikeCanTurn(const Table& t)
+{
+	return t.GetNumberOfCards(DECK) + t.GetNumberOfCards(PLAY) > 0;
+}
+
+inline int KlondikeTurn(const Table& t, Move *moves)
+{
+	int n = 0;
+	if (t.GetNumberOfCards(DECK) > 0)
+		while (n < t.GetDraw() & n < t.GetNumberOfCards(DECK)) moves[n++] = MakeMove(DECK, PLAY, 1);
+	else
+		while (n < t.GetNumberOfCards(PLAY)) moves[n++] = MakeMove(PLAY, DECK, 1);
+	return n;
+}
+
+const StackRule klondikerules[NUMSTACKS] = {
+	{ "deck", STACK_STOCK, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, 0, 0, -1, false },
+	{ "play", STACK_WASTE, BUILD_NONE, EMPTY_NONE, GRAB_TOP, 0, 1, 0, -1, false },
+	{ "suit1", STACK_FOUNDATION, BUILD_UP_SUIT, EMPTY_ACE, GRAB_TOP, 13, 3, 0, -1, false },
+	{ "suit2", STACK_FOUNDATION, BUILD_UP_SUIT, EMPTY_ACE, GRAB_TOP, 13, 4, 0, -1, false },
+	{ "suit3", STACK_FOUNDATION, BUILD_UP_SUIT, EMPTY_ACE, GRAB_TOP, 13, 5, 0, -1, false },
+	{ "suit4", STACK_FOUNDATION, BUILD_UP_SUIT, EMPTY_ACE, GRAB_TOP, 13, 6, 0, -1, false },
+	{ "pile1", STACK_HIDDEN, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, 0, 1, -1, false },
+	{ "pile2", STACK_HIDDEN, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, 1, 1, -1, false },
+	{ "pile3", STACK_HIDDEN, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, 2, 1, -1, false },
+	{ "pile4", STACK_HIDDEN, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, 3, 1, -1, false },
+	{ "pile5", STACK_HIDDEN, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, 4, 1, -1, false },
+	{ "pile6", STACK_HIDDEN, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, 5, 1, -1, false },
+	{ "pile7", STACK_HIDDEN, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, 6, 1, -1, false },
+	{ "tableau1", STACK_TABLEAU, BUILD_DOWN_ALTERNATE, EMPTY_KING, GRAB_RUN, 0, 0, 1, PILE1, true },
+	{ "tableau2", STACK_TABLEAU, BUILD_DOWN_ALTERNATE, EMPTY_KING, GRAB_RUN, 0, 1, 1, PILE2, true },
+	{ "tableau3", STACK_TABLEAU, BUILD_DOWN_ALTERNATE, EMPTY_KING, GRAB_RUN, 0, 2, 1, PILE3, true },
+	{ "tableau4", STACK_TABLEAU, BUILD_DOWN_ALTERNATE, EMPTY_KING, GRAB_RUN, 0, 3, 1, PILE4, true },
+	{ "tableau5", STACK_TABLEAU, BUILD_DOWN_ALTERNATE, EMPTY_KING, GRAB_RUN, 0, 4, 1, PILE5, true },
+	{ "tableau6", STACK_TABLEAU, BUILD_DOWN_ALTERNATE, EMPTY_KING, GRAB_RUN, 0, 5, 1, PILE6, true },
+	{ "tableau7", STACK_TABLEAU, BUILD_DOWN_ALTERNATE, EMPTY_KING, GRAB_RUN, 0, 6, 1, PILE7, true }
+};
+
+const Variant klondikevariant = { "Klondike", 1, NUMSTACKS, 7, klondikerules, false, false, KlondikeDeal, KlondikeCanTurn, KlondikeTurn };
+
+//FreeCell: four cells, four foundations, eight tableaux, everything face up
+
+enum { FREECELL_CELL1 = 0, FREECELL_FOUNDATION1 = 4, FREECELL_TABLEAU1 = 8, FREECELL_NUMSTACKS = 16 };
+
+inline void FreeCellDeal(Table& t, const unsigned char *shuffled)
+{
+	for (int i=0; i<NUMCARDS; i++) t.Push(FREECELL_TABLEAU1 + i%8, shuffled[NUMCARDS-1-i]);
+}
+
+#define FREECELL_CELL(n) { "cell" #n, STACK_CELL, BUILD_ANY, EMPTY_ANY, GRAB_TOP, 1, n-1, 0, -1, false }
+#define FREECELL_FOUNDATION(n) { "suit" #n, STACK_FOUNDATION, BUILD_UP_SUIT, EMPTY_ACE, GRAB_NONE, 13, n+3, 0, -1, false }
+#define FREECELL_TABLEAU(n) { "tableau" #n, STACK_TABLEAU, BUILD_DOWN_ALTERNATE, EMPTY_ANY, GRAB_RUN, 0, n-1, 1, -1, true }
+
+const StackRule freecellrules[FREECELL_NUMSTACKS] = {
+	FREECELL_CELL(1), FREECELL_CELL(2), FREECELL_CELL(3), FREECELL_CELL(4),
+	FREECELL_FOUNDATION(1), FREECELL_FOUNDATION(2), FREECELL_FOUNDATION(3), FREECELL_FOUNDATION(4),
+	FREECELL_TABLEAU(1), FREECELL_TABLEAU(2), FREECELL_TABLEAU(3), FREECELL_TABLEAU(4),
+	FREECELL_TABLEAU(5), FREECELL_TABLEAU(6), FREECELL_TABLEAU(7), FREECELL_TABLEAU(8)
+};
+
+const Variant freecellvariant = { "FreeCell", 1, FREECELL_NUMSTACKS, 8, freecellrules, true, true, FreeCellDeal, NULL, NULL };
+
+//Spider, two decks: the stock deals a row onto the ten tableaux, full suits go up whole
+
+enum { SPIDER_STOCK = 0, SPIDER_FOUNDATION1 = 1, SPIDER_TABLEAU1 = 9, SPIDER_HIDDEN1 = 19, SPIDER_NUMSTACKS = 29 };
+
+inline void SpiderDeal(Table& t, const unsigned char *shuffled)
+{
+	int top = 2*NUMCARDS;
+	for (int row=0; row<6; row++)
+		for (int c=0; c<10; c++) {
+			int height = c < 4 ? 6 : 5;  //54 cards, the last of each column face up
+			if (row < height - 1) t.Push(SPIDER_HIDDEN1 + c, shuffled[--top]);
+			else if (row == height - 1) t.Push(SPIDER_TABLEAU1 + c, shuffled[--top]);
+		}
+	for (int i=0; i<top; i++) t.Push(SPIDER_STOCK, shuffled[i]);
+}
+
+inline bool SpiderCanTurn(const Table& t)  //only with no tableau empty
+{
+	if (t.GetNumberOfCards(SPIDER_STOCK) == 0) return false;
+	for (int c=0; c<10; c++)
+		if (t.GetNumberOfCards(SPIDER_TABLEAU1 + c) == 0) return false;
+	return true;
+}
+
+inline int SpiderTurn(const Table& /*t*/, Move *moves)
+{
+	for (int c=0; c<10; c++) moves[c] = MakeMove(SPIDER_STOCK, SPIDER_TABLEAU1 + c, 1);
+	return 10;
+}
+
+#define SPIDER_FOUNDATION(n) { "suit" #n, STACK_FOUNDATION, BUILD_COMPLETE, EMPTY_NONE, GRAB_NONE, 13, n+1, 0, -1, false }
+#define SPIDER_TABLEAU(n) { "tableau" #n, STACK_TABLEAU, BUILD_DOWN_ANY, EMPTY_ANY, GRAB_SUITRUN, 0, n-1, 1, SPIDER_HIDDEN1+n-1, true }
+#define SPIDER_HIDDEN(n) { "pile" #n, STACK_HIDDEN, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, n-1, 1, -1, false }
+
+const StackRule spiderrules[SPIDER_NUMSTACKS] = {
+	{ "deck", STACK_STOCK, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, 0, 0, -1, false },
+	SPIDER_FOUNDATION(1), SPIDER_FOUNDATION(2), SPIDER_FOUNDATION(3), SPIDER_FOUNDATION(4),
+	SPIDER_FOUNDATION(5), SPIDER_FOUNDATION(6), SPIDER_FOUNDATION(7), SPIDER_FOUNDATION(8),
+	SPIDER_TABLEAU(1), SPIDER_TABLEAU(2), SPIDER_TABLEAU(3), SPIDER_TABLEAU(4), SPIDER_TABLEAU(5),
+	SPIDER_TABLEAU(6), SPIDER_TABLEAU(7), SPIDER_TABLEAU(8), SPIDER_TABLEAU(9), SPIDER_TABLEAU(10),
+	SPIDER_HIDDEN(1), SPIDER_HIDDEN(2), SPIDER_HIDDEN(3), SPIDER_HIDDEN(4), SPIDER_HIDDEN(5),
+	SPIDER_HIDDEN(6), SPIDER_HIDDEN(7), SPIDER_HIDDEN(8), SPIDER_HIDDEN(9), SPIDER_HIDDEN(10)
+};
+
+const Variant spidervariant = { "Spider", 2, SPIDER_NUMSTACKS, 10, spiderrules, true, false, SpiderDeal, SpiderCanTurn, SpiderTurn };
+
+//Yukon: Klondike's tableaux with no stock, any face-up card moves with what's on it
+
+enum { YUKON_FOUNDATION1 = 0, YUKON_TABLEAU1 = 4, YUKON_HIDDEN1 = 11, YUKON_NUMSTACKS = 18 };
+
+inline void YukonDeal(Table& t, const unsigned char *shuffled)
+{
+	int top = NUMCARDS;
+	for (int c=0; c<7; c++) {
+		for (int i=0; i<c; i++) t.Push(YUKON_HIDDEN1 + c, shuffled[--top]);  //21 face down
+		for (int i=0; i<(c ? 5 : 1); i++) t.Push(YUKON_TABLEAU1 + c, shuffled[--top]);  //31 face up
+	}
+}
+
+#define YUKON_FOUNDATION(n) { "suit" #n, STACK_FOUNDATION, BUILD_UP_SUIT, EMPTY_ACE, GRAB_TOP, 13, n+2, 0, -1, false }
+#define YUKON_TABLEAU(n) { "tableau" #n, STACK_TABLEAU, BUILD_DOWN_ALTERNATE, EMPTY_KING, GRAB_FACEUP, 0, n-1, 1, YUKON_HIDDEN1+n-1, true }
+#define YUKON_HIDDEN(n) { "pile" #n, STACK_HIDDEN, BUILD_NONE, EMPTY_NONE, GRAB_NONE, 0, n-1, 1, -1, false }
+
+const StackRule yukonrules[YUKON_NUMSTACKS] = {
+	YUKON_FOUNDATION(1), YUKON_FOUNDATION(2), YUKON_FOUNDATION(3), YUKON_FOUNDATION(4),
+	YUKON_TABLEAU(1), YUKON_TABLEAU(2), YUKON_TABLEAU(3), YUKON_TABLEAU(4),
+	YUKON_TABLEAU(5), YUKON_TABLEAU(6), YUKON_TABLEAU(7),
+	YUKON_HIDDEN(1), YUKON_HIDDEN(2), YUKON_HIDDEN(3), YUKON_HIDDEN(4),
+	YUKON_HIDDEN(5), YUKON_HIDDEN(6), YUKON_HIDDEN(7)
+};
+
+const Variant yukonvariant = { "Yukon", 1, YUKON_NUMSTACKS, 7, yukonrules, true, false, YukonDeal, NULL, NULL };
+
+const Variant * const variants[] = { &klondikevariant, &freecellvariant, &spidervariant, &yukonvariant };
+#define NUMVARIANTS 4
+
+#endif
@@ -0,0 +1,150 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SAVEGAME__
+#define __SAVEGAME__
+
+#include "klondike.h"
+#include <cstdio>
+#include <string>
+#include <stdint.h>
+
+/* Saved game
+
+The game in progress as a fixed 98-byte file, so the next start can put the same table back
+up without dealing, parsing or decoding anything.  Layout, numbers little-endian:
+
+	"SOL1"                        4 bytes
+	draw                          1, 1 or 3
+	flags                         1, SNAPSHOT_WON if the table is a counted win
+	deal number                   8
+	wins, losses                  4 each
+	stack sizes                   20 x 1, in klondike stack id order
+	cards                         52 x 1, each stack's ids bottom first, one stack after another
+	checksum                      4, FNV-1a of everything before it
+
+Which cards are face up needn't be stored: in this game it follows from the stack, the deck
+and the piles face down, the rest face up.  The file is written to a temporary name and
+renamed over the old one, so a save cut short leaves the last good one in place, and a file
+that is short, fails its checksum, or doesn't hold each card exactly once is refused.
+
+*/
+
+#define SNAPSHOT_SIZE 98
+#define SNAPSHOT_WON 1
+
+struct Snapshot
+{
+	Klondike position;
+	uint64_t dealnumber;
+	unsigned wins, losses;
+	bool won;
+};
+
+inline uint32_t SnapshotChecksum(const unsigned char *p, int n)
+{
+	uint32_t h = 2166136261u;
+	for (int i=0; i<n; i++) h = (h ^ p[i]) * 16777619u;
+	return h;
+}
+
+inline void SnapshotPut(unsigned char *&p, uint64_t v, int bytes)
+{
+	for (int i=0; i<bytes; i++) *p++ = (unsigned char) (v >> 8*i);
+}
+
+inline uint64_t SnapshotGet(const unsigned char *&p, int bytes)
+{
+	uint64_t v = 0;
+	for (int i=0; i<bytes; i++) v |= (uint64_t) *p++ << 8*i;
+	return v;
+}
+
+inline bool WriteSnapshot(const std::string& filename, const Snapshot& s)
+{
+	unsigned char buf[SNAPSHOT_SIZE], *p = buf;
+	memcpy(p, "SOL1", 4); p += 4;
+	SnapshotPut(p, s.position.GetDraw(), 1);
+	SnapshotPut(p, s.won ? SNAPSHOT_WON : 0, 1);
+	SnapshotPut(p, s.dealnumber, 8);
+	SnapshotPut(p, s.wins, 4);
+	SnapshotPut(p, s.losses, 4);
+	for (int st=0; st<NUMSTACKS; st++) SnapshotPut(p, s.position.GetNumberOfCards(st), 1);
+	for (int st=0; st<NUMSTACKS; st++) {
+		int n = s.position.GetNumberOfCards(st);
+		if (p + n > buf + SNAPSHOT_SIZE - 4) return false;  //more than 52 cards, don't write nonsense
+		memcpy(p, s.position.GetCards(st), n);
+		p += n;
+	}
+	if (p != buf + SNAPSHOT_SIZE - 4) return false;
+	SnapshotPut(p, SnapshotChecksum(buf, SNAPSHOT_SIZE - 4), 4);
+
+	std::string temp = filename + ".tmp";
+	FILE *f = fopen(temp.c_str(), "wb");
+	if (!f) return false;
+	bool ok = fwrite(buf, 1, SNAPSHOT_SIZE, f) == SNAPSHOT_SIZE;
+	ok &= fflush(f) == 0;
+	ok &= fclose(f) == 0;
+#ifdef _WIN32
+	if (ok) remove(filename.c_str());  //rename won't replace a file there
+#endif
+	if (ok) ok = rename(temp.c_str(), filename.c_str()) == 0;
+	if (!ok) remove(temp.c_str());
+	return ok;
+}
+
+inline bool ReadSnapshot(const std::string& filename, Snapshot& s)
+{
+	unsigned char buf[SNAPSHOT_SIZE + 1];
+	FILE *f = fopen(filename.c_str(), "rb");
+	if (!f) return false;
+	size_t n = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+	if (n != SNAPSHOT_SIZE || memcmp(buf, "SOL1", 4) != 0) return false;
+	const unsigned char *p = buf + SNAPSHOT_SIZE - 4;
+	if (SnapshotGet(p, 4) != SnapshotChecksum(buf, SNAPSHOT_SIZE - 4)) return false;
+
+	p = buf + 4;
+	int draw = (int) SnapshotGet(p, 1);
+	int flags = (int) SnapshotGet(p, 1);
+	if (draw != 1 & draw != 3) return false;
+	s.dealnumber = SnapshotGet(p, 8);
+	s.wins = (unsigned) SnapshotGet(p, 4);
+	s.losses = (unsigned) SnapshotGet(p, 4);
+	s.won = (flags & SNAPSHOT_WON) != 0;
+
+	const unsigned char *sizes = p, *cards = p + NUMSTACKS;
+	int total = 0;
+	for (int st=0; st<NUMSTACKS; st++) {
+		if (sizes[st] > STACKSIZE) return false;
+		total += sizes[st];
+	}
+	if (total != NUMCARDS) return false;
+	bool seen[NUMCARDS] = { false };
+	for (int i=0; i<NUMCARDS; i++) {
+		if (cards[i] >= NUMCARDS || seen[cards[i]]) return false;
+		seen[cards[i]] = true;
+	}
+
+	s.position.Clear();
+	s.position.SetDraw(draw);
+	for (int st=0; st<NUMSTACKS; st++) {
+		s.position.SetCards(st, cards, sizes[st]);
+		cards += sizes[st];
+	}
+	return true;
+}
+
+#endif
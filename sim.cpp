@@ -0,0 +1,366 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/* solitaire-sim
+
+Plays a range of deals (see deal.h) with an automatic strategy, on every core, and streams one
+result per game.  No wxWidgets and no display; it runs the same Klondike engine the game does.
+
+	solitaire-sim --seed-range 1-1000000 --draw 3 --strategy greedy --out draw3.jsonl
+
+Strategies:
+
+	greedy   the best move by QuickHint's scores (see hint.h), but never the one that takes back
+	         the move before, turning the deck when nothing scores, and Klondike::Finish to
+	         play out the end
+	random   any legal move, picked with a generator seeded from the deal number
+
+--variant klondike|freecell|spider|yukon plays the game through rules.h's Table instead, with
+random moves, and checks the rules as it goes: each card on the table exactly once, GenerateMoves
+listing just the moves CanMove allows, and for klondike, Table agreeing with the Klondike engine
+on every possible move of every position, the two played side by side.  A game that breaks one
+stops there, and solitaire-sim reports it on stderr and exits 1.
+
+	solitaire-sim --seed-range 1-10000 --variant spider --out /dev/null
+
+Both are repeatable: the same deal and options play the same game.  A game ends won, with no
+legal move, after --max-moves moves, or, for greedy, after a whole pass through the deck with
+nothing but deck turns.
+
+--format jsonl writes a line per game:
+
+	{"deal":17,"draw":1,"strategy":"greedy","won":false,"moves":93,"foundation":12}
+
+with "variant":"Spider" after the deal for a --variant game.
+
+--format binary writes an 8-byte header, "SIM1", draw, strategy (0 greedy, 1 random), the
+variant (0 for none, else its place in rules.h's variants plus one) and a zero byte, then a 16-byte record per game, little-endian: deal 8, moves 4, foundation 1,
+won 1, two zero bytes.  Games finish out of deal order across threads, so records are in the
+order they finished.  Throughput, games/s and moves/s, goes to stderr at the end.
+
+*/
+
+#include "klondike.h"
+#include "rules.h"
+#include "deal.h"
+#include "hint.h"
+#include "workpool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+#define SIM_HEADERSIZE 8
+#define SIM_BUFFER 65536  //bytes of results each thread gathers before writing them out
+
+enum { STRATEGY_GREEDY, STRATEGY_RANDOM };
+const char *strategynames[] = { "greedy", "random" };
+
+struct SimResult
+{
+	uint64_t deal;
+	uint32_t moves;
+	int foundation;
+	bool won;
+};
+
+void usage()
+{
+	fprintf(stderr,
+		"usage: solitaire-sim --seed-range FIRST-LAST [options]\n"
+		"  --draw 1|3          cards drawn from the deck (default 1)\n"
+		"  --strategy NAME     greedy or random (default greedy)\n"
+		"  --variant NAME      klondike, freecell, spider or yukon through rules.h, random, checked\n"
+		"  --threads N         worker threads (default: all cores)\n"
+		"  --max-moves N       moves before a game is given up (default 1000)\n"
+		"  --format FORMAT     jsonl or binary (default jsonl)\n"
+		"  --out FILE          results file, - for stdout (default)\n");
+	exit(1);
+}
+
+//the greedy strategy's move: the best HintScore but for last's inverse, which would start a
+//back-and-forth; count 0 if nothing scores
+Move Greedy(const Klondike& k, Move last)
+{
+	Move list[MAXMOVES];
+	int n = k.GenerateMoves(list);
+	Move best = { 0, 0, 0, 0 };
+	int bestscore = 0;
+	for (int i=0; i<n; i++) {
+		if (list[i].from == last.to & list[i].to == last.from & list[i].count == last.count) continue;
+		int score = HintScore(k, list[i]);
+		if (score > bestscore) {
+			bestscore = score;
+			best = list[i];
+		}
+	}
+	return best;
+}
+
+//plays one deal to the end by the strategy
+SimResult Play(uint64_t deal, int draw, int strategy, uint32_t maxmoves)
+{
+	Klondike k;
+	DealGame(k, deal, draw);
+	DealRandom r(~deal);  //not the deal's own sequence
+	Move list[MAXMOVES], finish[MAXFINISH], last = { 0, 0, 0, 0 };
+	SimResult s;
+	s.deal = deal;
+	s.moves = 0;
+	int idle = 0;  //deck turns in a row
+	while (!k.IsWon() & s.moves < maxmoves) {
+		Move m;
+		if (strategy == STRATEGY_GREEDY) {
+			int n = k.Finish(finish);
+			if (n >= 0) {
+				for (int i=0; i<n; i++) k.Apply(finish[i]);
+				s.moves += n;
+				break;
+			}
+			m = Greedy(k, last);
+			if (m.count == 0) m = k.DeckMove();
+			if (m.count == 0) break;
+			if (m.from == DECK | m.to == DECK) {
+				if (++idle > k.GetNumberOfCards(DECK) + k.GetNumberOfCards(PLAY) + 1) break;  //been all the way through
+			}
+			else idle = 0;
+		}
+		else {
+			int n = k.GenerateMoves(list);
+			if (n == 0) break;
+			m = list[r.Next32() % n];
+		}
+		k.Apply(m);
+		last = m;
+		s.moves++;
+	}
+	s.won = k.IsWon();
+	s.foundation = k.GetNumberOfCards(SUIT1) + k.GetNumberOfCards(SUIT2) + k.GetNumberOfCards(SUIT3) + k.GetNumberOfCards(SUIT4);
+	return s;
+}
+
+//what's wrong with a Table position, empty if nothing; k is the same position in the Klondike
+//engine, for a klondike Table, else NULL
+std::string CheckTable(const Table& t, const Klondike *k)
+{
+	const Variant& v = t.GetVariant();
+	char error[160];
+	int seen[MAXTABLECARDS] = {0}, n = 0;
+	for (int s=0; s<v.numstacks; s++)
+		for (int i=0; i<t.GetNumberOfCards(s); i++) {
+			int c = t.GetCards(s)[i];
+			if (c >= t.NumberOfCards() || seen[c]++) {
+				snprintf(error, sizeof(error), "card %d on %s is a second copy or no card", c, v.rules[s].name);
+				return error;
+			}
+			n++;
+		}
+	if (n != t.NumberOfCards()) return "cards gone from the table";
+
+	Move list[MAXTABLEMOVES];
+	int generated = t.GenerateMoves(list), legal = t.CanTurn();
+	for (int i=0; i<generated; i++)
+		if (list[i].flags & MOVE_TURN ? !t.CanTurn() : !t.CanMove(list[i].from, list[i].to, list[i].count)) {
+			snprintf(error, sizeof(error), "GenerateMoves gave %s to %s, %d cards, which CanMove doesn't allow",
+				v.rules[list[i].from].name, v.rules[list[i].to].name, list[i].count);
+			return error;
+		}
+	for (int from=0; from<v.numstacks; from++)
+		for (int to=0; to<v.numstacks; to++)
+			for (int count=1; count<=t.GetNumberOfCards(from); count++) {
+				bool can = t.CanMove(from, to, count);
+				legal += can;
+				if (k && from != DECK & to != DECK && can != k->IsLegal(MakeMove(from, to, count))) {
+					snprintf(error, sizeof(error), "%s to %s, %d cards, is %s to Table but not to Klondike",
+						v.rules[from].name, v.rules[to].name, count, can ? "legal" : "illegal");
+					return error;
+				}
+			}
+	if (legal != generated) return "GenerateMoves missed moves CanMove allows";
+	if (!k) return "";
+
+	for (int s=0; s<NUMSTACKS; s++)
+		if (t.GetNumberOfCards(s) != k->GetNumberOfCards(s) || memcmp(t.GetCards(s), k->GetCards(s), k->GetNumberOfCards(s))) {
+			snprintf(error, sizeof(error), "%s isn't the same in Table and Klondike", v.rules[s].name);
+			return error;
+		}
+	Move d = k->DeckMove(), turn[MAXTURNMOVES];
+	if (t.CanTurn() != (d.count > 0)) return "Table and Klondike disagree on turning the deck";
+	if (t.CanTurn()) {
+		int n = t.Turn(turn);
+		for (int i=0; i<n; i++)
+			if (turn[i].from != d.from | turn[i].to != d.to | n != d.count) return "Table turns the deck differently to Klondike";
+	}
+	return "";
+}
+
+//plays one deal of a variant through Table with random moves, checking each position; a Klondike
+//engine game follows along for klondike.  check is the first thing wrong, and the game stops there.
+SimResult PlayTable(uint64_t deal, int draw, const Variant& v, uint32_t maxmoves, std::string& check)
+{
+	Table t(v);
+	unsigned char shuffled[MAXTABLECARDS];
+	ShuffleDecks(deal, v.decks, shuffled);
+	t.Deal(shuffled, draw);
+	Klondike k, *follow = &v == &klondikevariant ? &k : NULL;
+	if (follow) DealGame(k, deal, draw);
+	DealRandom r(~deal);
+	Move list[MAXTABLEMOVES];
+	SimResult s;
+	s.deal = deal;
+	s.moves = 0;
+	while ((check = CheckTable(t, follow)).empty() && !t.IsWon() & s.moves < maxmoves) {
+		int n = t.GenerateMoves(list);
+		if (n == 0) break;
+		Move m = list[r.Next32() % n];
+		t.Apply(m);
+		if (follow) k.Apply(m.flags & MOVE_TURN ? k.DeckMove() : m);
+		s.moves++;
+	}
+	s.won = t.IsWon();
+	s.foundation = t.FoundationCards();
+	return s;
+}
+
+void Put(std::string& out, uint64_t v, int bytes)
+{
+	for (int i=0; i<bytes; i++) out += (char) (unsigned char) (v >> 8*i);
+}
+
+void Format(std::string& out, const SimResult& s, int draw, int strategy, const Variant *variant, bool binary)
+{
+	if (binary) {
+		Put(out, s.deal, 8);
+		Put(out, s.moves, 4);
+		Put(out, s.foundation, 1);
+		Put(out, s.won, 1);
+		Put(out, 0, 2);
+		return;
+	}
+	char line[160], name[40] = "";
+	if (variant) snprintf(name, sizeof(name), "\"variant\":\"%s\",", variant->name);
+	snprintf(line, sizeof(line), "{\"deal\":%llu,%s\"draw\":%d,\"strategy\":\"%s\",\"won\":%s,\"moves\":%u,\"foundation\":%d}\n",
+		(unsigned long long) s.deal, name, draw, strategynames[strategy], s.won ? "true" : "false", (unsigned) s.moves, s.foundation);
+	out += line;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long first = 0, last = 0;
+	bool range = false, binary = false;
+	int draw = 1, strategy = STRATEGY_GREEDY, variant = -1;
+	bool strategyset = false;
+	int threads = std::thread::hardware_concurrency();
+	unsigned long maxmoves = 1000;
+	std::string filename = "-";
+
+	for (int i=1; i<argc; i++) {
+		std::string arg = argv[i];
+		if (i+1 == argc) usage();
+		std::string val = argv[++i];
+		if (arg == "--seed-range") range = sscanf(val.c_str(), "%llu-%llu", &first, &last) == 2 && first <= last && last != ~0ULL;
+		else if (arg == "--draw") draw = atoi(val.c_str());
+		else if (arg == "--threads") threads = atoi(val.c_str());
+		else if (arg == "--max-moves") maxmoves = strtoul(val.c_str(), NULL, 10);
+		else if (arg == "--out") filename = val;
+		else if (arg == "--strategy" & val == "greedy") { strategy = STRATEGY_GREEDY; strategyset = true; }
+		else if (arg == "--strategy" & val == "random") { strategy = STRATEGY_RANDOM; strategyset = true; }
+		else if (arg == "--variant") {
+			for (variant=NUMVARIANTS-1; variant>=0; variant--) {  //by its name in lower case
+				std::string name = variants[variant]->name;
+				for (size_t c=0; c<name.size(); c++) name[c] = tolower(name[c]);
+				if (name == val) break;
+			}
+			if (variant == -1) usage();
+		}
+		else if (arg == "--format" & val == "jsonl") binary = false;
+		else if (arg == "--format" & val == "binary") binary = true;
+		else usage();
+	}
+	if (!range | (draw != 1 & draw != 3)) usage();
+	if (variant != -1) {  //Table games are random
+		if (strategyset & strategy != STRATEGY_RANDOM) usage();
+		strategy = STRATEGY_RANDOM;
+	}
+	const Variant *v = variant == -1 ? NULL : variants[variant];
+	if (threads < 1) threads = 1;
+
+	FILE *out = filename == "-" ? stdout : fopen(filename.c_str(), "wb");
+	if (!out) {
+		fprintf(stderr, "solitaire-sim: can't open %s\n", filename.c_str());
+		return 1;
+	}
+	if (binary) {
+		std::string header = "SIM1";
+		Put(header, draw, 1);
+		Put(header, strategy, 1);
+		Put(header, variant + 1, 1);
+		Put(header, 0, 1);
+		fwrite(header.data(), 1, SIM_HEADERSIZE, out);
+	}
+
+	std::vector<std::string> buffers(threads);
+	std::vector<uint64_t> wins(threads, 0), moves(threads, 0);
+	std::mutex lock;  //guards out and broken
+	uint64_t broken = 0;  //games that broke the rules, see CheckTable
+	std::string firstbroken;
+	bool failed = false;
+	typedef std::chrono::steady_clock clock;
+	clock::time_point start = clock::now();
+
+	WorkPool pool;
+	pool.Run(first, last + 1, threads, [&](int t, uint64_t deal) {
+		std::string check;
+		SimResult s = v ? PlayTable(deal, draw, *v, (uint32_t) maxmoves, check) : Play(deal, draw, strategy, (uint32_t) maxmoves);
+		if (!check.empty()) {
+			std::lock_guard<std::mutex> guard(lock);
+			if (broken++ == 0) firstbroken = "deal " + std::to_string(deal) + " move " + std::to_string(s.moves) + ": " + check;
+		}
+		wins[t] += s.won;
+		moves[t] += s.moves;
+		std::string& buf = buffers[t];
+		Format(buf, s, draw, strategy, v, binary);
+		if (buf.size() >= SIM_BUFFER) {
+			std::lock_guard<std::mutex> guard(lock);
+			failed |= fwrite(buf.data(), 1, buf.size(), out) != buf.size();
+			buf.clear();
+		}
+	});
+	for (int t=0; t<threads; t++)
+		failed |= fwrite(buffers[t].data(), 1, buffers[t].size(), out) != buffers[t].size();
+	failed |= fflush(out) != 0;
+	if (out != stdout) failed |= fclose(out) != 0;
+	if (failed) {
+		fprintf(stderr, "solitaire-sim: can't write %s\n", filename.c_str());
+		return 1;
+	}
+
+	double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	uint64_t games = last - first + 1, won = 0, played = 0;
+	for (int t=0; t<threads; t++) {
+		won += wins[t];
+		played += moves[t];
+	}
+	fprintf(stderr, "%s%sdraw %d, %s, deals %llu-%llu: %llu of %llu won (%.2f%%), %llu moves\n", v ? v->name : "", v ? ", " : "",
+		draw, strategynames[strategy], first, last, (unsigned long long) won, (unsigned long long) games, 100.0 * won / games, (unsigned long long) played);
+	fprintf(stderr, "%.2fs on %d threads, %.0f games/s, %.0f moves/s\n", elapsed, threads, games / elapsed, played / elapsed);
+	if (v) fprintf(stderr, "%llu games broke the rules%s%s\n", (unsigned long long) broken, broken ? ", the first at " : "", firstbroken.c_str());
+	return broken ? 1 : 0;
+}
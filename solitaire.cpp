@@ -1,5 +1,3 @@
-
-
 /*
 This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -17,95 +15,241 @@ This program is free software: you can redistribute it and/or modify
 
 
 #include "wx/wx.h"
-#include "cards/cards.h"
+#include "wx/stdpaths.h"
+#include "wx/filename.h"
+#include "cardsprites.h"  //generated by cards/packcards
+#include "cards/spritepack.h"
 #include "solitaire.xpm"
+#include "klondike.h"
+#include "rules.h"
+#include "solver.h"
+#include "deal.h"
+#include "hint.h"
+#include "savegame.h"
+#include "history.h"
 #include <map>
+#include <vector>
 #include <string>
+#include <algorithm>
 
-#include <algorithm>    // std::shuffle
-#include <array>        // std::array
-#include <random>       // std::default_random_engine
 #include <chrono>       // std::chrono::system_clock
+#include <cmath>
+#include <cerrno>
+#include <cctype>
+#include <atomic>
+#include <new>
 
 
+//sizes at scale 1; the table is drawn at tablescale, see SetTableScale:
 #define WIDTH 69 //card width, from .xpm images
 #define HEIGHT 100 //card height
 #define STAGGER 20 //for staggered decks, the vertical offset of each card in the stack
 #define PILEOFFSET 3 //used when creating piles under tableau, so they are offset slightly to indicate there are cards in the pile
 
+#define TABLEWIDTH 850 //the window area the table fills at scale 1
+#define TABLEHEIGHT 600
+#define SCALESTEPS 8 //scales go in steps of 1/SCALESTEPS, so a live resize rescales the faces only now and then
+#define MINSCALE 0.5
+#define MAXSCALE 4
+#define FACECACHE 4 //scales whose faces are kept
+
+//the table's layout, the columns and two rows of the variant's StackRules, which CardPane::HitTest works backwards from:
+#define LEFT 50 //the first column's left edge
+#define COLUMN 100 //from one column to the next
+#define TOPROW 100 //row 0, the top of the deck, play and suit stacks
+#define TABLEAUROW 250 //row 1, the top of the tableaux, one per column
+
 #define NEWGAME1 1000
 #define NEWGAME3 1001
+#define ANIMTIMER 1002
+#define HUDTIMER 1003
+#define DRAGTIMER 1004
+
+#define CHECKNODES 2000000  //Check Deal's solver budget, all threads together
+#define CHECKMEMORY (64*1024*1024)
+
+#define FRAMEMS 16 //animation step, about 60 a second, see Animation
+#define MAXSTEPS 8 //steps one timer event catches up on at most
+#define FLIGHTFRAMES 8 //steps a card takes to fly to its suit stack in auto-complete
+#define LAUNCHFRAMES 2 //steps between one card taking off and the next
+#define DEALFRAMES 10 //steps a card takes from the deck to its place in the deal
+#define DEALGAP 2 //steps between one card dealt and the next
+#define CASCADEGAP 6 //steps between cards leaving the suit stacks at a win
+#define GRAVITY 1.2 //pixels a step, each step, for a thrown card, at scale 1
+#define BOUNCE 0.75 //how much of its speed a thrown card keeps off the bottom
+
+#define SAVEMOVES 5 //moves between saves of the game in progress, besides the one at each deal and on exit
+
+#define HUDMS 1000 //the performance overlay's numbers are over this long, and change this often
+#define HUDLINES 7
 
 /* Program Organization
 
-After the obligatory wxwidgets wxApp and wxFrame, there are three application classes:
+After the obligatory wxwidgets wxApp and wxFrame, there are four application classes:
 
-	- Card: Encapsulates all the attributes of a single card. Created using the card definitions in cards/cards.h
+	- Card: Encapsulates all the attributes of a single card. Its face comes from cardfaces, unpacked at startup
+		from the sprite pack that cards/packcards builds out of the xpms in cards/cards.h
 	- Stack: Implements the stack used to define all the places in the game where cards can exist. Defines behaviors
 		that are used to move cards between stacks in a way to account for all cards.
+	- Animation: The cards in flight, for the deal, auto-complete and the win.
+	- PaintStats: What painting costs, for the performance overlay.
 	- CardPane: A subclass of wxPane where all the application behaviors, including stack transfer rules, are implemented.
 
+The rules themselves (which card lands where, how the deal is laid out) live in klondike.h, a wx-free engine
+that works on one-byte card ids.  Card carries its id, and CardPane asks the engine, so no rule check
+compares strings.  CardPane's stacks are an array built from the Klondike table in rules.h, whose StackRules
+say where each stack sits and what it takes, so laying out, hit testing and dropping cards are loops over
+the table rather than code for each stack.
+
 */
 
+//card faces, unpacked once at startup by LoadCardFaces, scaled by SetTableScale and shared by every Card:
+std::vector<wxImage> cardimages;  //as unpacked, scale 1
+std::vector<wxBitmap> cardfaces;  //at tablescale, indexed by klondike card id
+int facedecodes = 0;  //card images decoded so far, stays at 52 for the life of the program
+int facescales = 0;  //card bitmaps made from them so far, 52 for each scale the cache didn't have
+int bitmapsmade = 0;  //every bitmap the program has made, faces and table layers, for the performance overlay
+double facesms = 0;  //how long LoadCardFaces took, for the performance overlay
+
+//near enough when the program started, static initialisation being among the first things it does;
+//the performance overlay's time to the first frame counts from here
+std::chrono::steady_clock::time_point launched = std::chrono::steady_clock::now();
+
+//every operator new in the program, counted for bench.cpp and rendercheck.cpp, which define
+//SOLITAIRE_BENCH, and for the performance overlay when the game is built with SOLITAIRE_HUD
+//(configure --enable-hud); what GTK or cairo malloc directly isn't seen.  The game as released
+//doesn't count, and the overlay shows n/a.
+#if defined(SOLITAIRE_BENCH) || defined(SOLITAIRE_HUD)
+#define COUNTALLOCATIONS 1
+
+std::atomic<unsigned long long> allocations(0);
+
+void *operator new(size_t n)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(n ? n : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+inline unsigned long long AllocationCount() { return allocations; }
+#else
+#define COUNTALLOCATIONS 0
+
+inline unsigned long long AllocationCount() { return 0; }
+#endif
+
+//the table's scale and the sizes at it
+double tablescale = 1;
+int cardwidth = WIDTH, cardheight = HEIGHT, stagger = STAGGER;
+
+inline int Scaled(int n) { return (int) (n * tablescale + 0.5); }
+
+struct FaceSet
+{
+	std::vector<wxBitmap> faces;
+	unsigned used;  //when last chosen, by facecacheclock
+};
+
+std::map<int, FaceSet> facecache;  //the faces at each of the last few scales, by card width
+unsigned facecacheclock = 0;
+
+void LoadCardFaces()
+{
+	if (cardimages.size() == NUMCARDS) return;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	SpritePack pack(cardsprites);
+	wxASSERT_MSG(pack.IsOk() && pack.GetCount() == NUMCARDS, "bad cardsprites.h");
+	cardimages.resize(NUMCARDS);
+	for (int id=0; id<NUMCARDS; id++) {
+		unsigned char *rgb = (unsigned char *) malloc(pack.GetWidth() * pack.GetHeight() * 3);
+		pack.Unpack(id, rgb);
+		cardimages[id] = wxImage(pack.GetWidth(), pack.GetHeight(), rgb);  //the wxImage frees rgb
+		facedecodes++;
+	}
+	facesms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+//sets the table's scale and the card faces drawn at it.  Faces are scaled once per scale, with
+//wx's high quality resampling, and the last FACECACHE scales kept, so painting never scales
+//anything and going back to a recent size costs nothing.
+void SetTableScale(double scale)
+{
+	tablescale = scale;
+	cardwidth = Scaled(WIDTH);
+	cardheight = Scaled(HEIGHT);
+	stagger = Scaled(STAGGER);
+	if (facecache.find(cardwidth) == facecache.end() && facecache.size() >= FACECACHE) {
+		std::map<int, FaceSet>::iterator oldest = facecache.begin();
+		for (std::map<int, FaceSet>::iterator it = facecache.begin(); it != facecache.end(); ++it)
+			if (it->second.used < oldest->second.used) oldest = it;
+		facecache.erase(oldest);
+	}
+	FaceSet& set = facecache[cardwidth];
+	set.used = ++facecacheclock;
+	if (set.faces.empty()) {
+		for (int id=0; id<NUMCARDS; id++) {
+			if (cardwidth == WIDTH & cardheight == HEIGHT)
+				set.faces.push_back(wxBitmap(cardimages[id]));
+			else
+				set.faces.push_back(wxBitmap(cardimages[id].Scale(cardwidth, cardheight, wxIMAGE_QUALITY_HIGH)));
+			facescales++;
+			bitmapsmade++;
+		}
+	}
+	cardfaces = set.faces;  //wxBitmaps share their data, this copies 52 handles
+}
+
 class Card
 {
 public:
-	Card(const char * image[], std::string cardsuit, std::string cardrank, std::string cardcolor, int ranknum, int posx, int posy)
+	Card(unsigned char cardid, int posx, int posy)
 	{
-		face = wxBitmap(image);
 		b.x = posx;
 		b.y = posy;
-		b.width = WIDTH;
-		b.height = HEIGHT;
-		suit = cardsuit;
-		rankstring = cardrank;
-		color = cardcolor;
-		rank = ranknum;
+		b.width = cardwidth;
+		b.height = cardheight;
+		id = cardid;
 	}
 	
-	Card(const char * image[], std::string cardsuit, std::string cardrank, std::string cardcolor, int ranknum, wxPoint pos)
+	Card(unsigned char cardid, wxPoint pos)
 	{
-		face = wxBitmap(image);
 		b.x = pos.x;
 		b.y = pos.y;
-		b.width = WIDTH;
-		b.height = HEIGHT;
-		suit = cardsuit;
-		rankstring = cardrank;
-		color = cardcolor;
-		rank = ranknum;
+		b.width = cardwidth;
+		b.height = cardheight;
+		id = cardid;
 	}
 	
 	Card() { 
-		face = wxBitmap(0,0);
 		b.x = 0;
 		b.y = 0;
-		b.width = WIDTH;
-		b.height = HEIGHT;
-		suit = "(blank)";
-		rankstring = "(blank)";
-		color = "(blank)";
-		rank = 0;
+		b.width = cardwidth;
+		b.height = cardheight;
+		id = NOCARD;
 	}
 	
-	int GetRank()
+	unsigned char GetId() const
 	{
-		return rank;
+		return id;
 	}
 	
-	std::string GetRankString()
+	int GetRank() const
 	{
-		return rankstring;
+		return CardRank(id);
 	}
 	
-	std::string GetSuit()
+	int GetSuit() const
 	{
-		return suit;
+		return CardSuit(id);
 	}
 	
-	std::string GetColor()
+	int GetColor() const
 	{
-		return color;
+		return CardColor(id);
 	}
 	
 	bool HitTest(int locx, int locy)
@@ -113,7 +257,7 @@ public:
 		return b.Contains(locx, locy);
 	}
 	
-	wxPoint GetPosition()
+	wxPoint GetPosition() const
 	{
 		wxPoint p;
 		p.x = b.x;
@@ -139,12 +283,19 @@ public:
 		b.y += dy;
 	}
 	
-	int GetX()
+	//takes on the card size at the current scale
+	void Resize()
+	{
+		b.width = cardwidth;
+		b.height = cardheight;
+	}
+	
+	int GetX() const
 	{
 		return b.x;
 	}
 	
-	int GetY()
+	int GetY() const
 	{
 		return b.y;
 	}
@@ -152,7 +303,7 @@ public:
 	void DrawCard(wxDC& dc, bool faceup=true)
 	{
 		if (faceup) {
-			if (face.IsOk()) dc.DrawBitmap(face,b.x,b.y);
+			if (id != NOCARD) dc.DrawBitmap(cardfaces[CardFace(id)],b.x,b.y);  //a second deck's ids share the faces
 		}
 		else {
 			dc.SetPen(*wxLIGHT_GREY_PEN);
@@ -164,15 +315,15 @@ public:
 	{
 		return b;
 	}
-
-	//animate velocities;
-	int vert, horiz;
+	
+	const wxRect& GetRect() const
+	{
+		return b;
+	}
 
 private:
-	wxBitmap face;
 	wxRect b;
-	std::string suit, rankstring, color;
-	int rank;
+	unsigned char id;  //also the face, in cardfaces
 };
 
 
@@ -182,11 +333,12 @@ public:
 
 	Stack() 
 	{ 
-		bounds.width = WIDTH;
-		bounds.height = HEIGHT;
+		bounds.width = cardwidth;
+		bounds.height = cardheight;
 		facup = true;
 		outln = true;
 		stag = false;
+		deck.reserve(NUMCARDS);  //room for the whole deck, so moving cards never allocates
 	}
 
 	Stack(int x, int y, int w, int h, bool faceup=true, bool outline=true, bool staggered=false)
@@ -198,6 +350,7 @@ public:
 		facup = faceup;
 		outln = outline;
 		stag = staggered;
+		deck.reserve(NUMCARDS);
 	}
 	
 	std::string GetName()
@@ -237,11 +390,14 @@ public:
 	
 	void ClearCards()
 	{
+		wxRect before = GetDrawnBounds();
 		deck.clear();
 		RecomputeBounds();
+		Changed(before);
 	}
 	
-	std::vector<Card> GetCards()
+	//a view, valid until the stack next changes
+	const std::vector<Card>& GetCards()
 	{
 		return deck;
 	}
@@ -258,94 +414,104 @@ public:
 	
 	void AddCard(Card c)
 	{
-		wxPoint pos;
-		if (deck.size()<=1) {
-			pos = GetPosition();
-		}
-		else {
-			pos = deck.back().GetPosition();
-			if (stag) pos.y += STAGGER;
-		}
-		c.SetPosition(pos);
+		wxRect before = GetDrawnBounds();
+		c.SetPosition(NextPosition());
 		deck.push_back(c);
 		RecomputeBounds();
+		Changed(before);
 	}
 	
-	void AddCards(std::vector<Card> cards)
+	void AddCards(const std::vector<Card>& cards)
 	{
 		if (cards.size() == 0) return;
-		for (std::vector<Card>::iterator it=cards.begin(); it!=cards.end(); ++it) {
-			wxPoint pos;
-			if (deck.size() == 0) {
-				pos = GetPosition();
-			}
-			else {
-				pos = deck.back().GetPosition();
-				if (stag) pos.y += STAGGER;
-			}
-			(*it).SetPosition(pos);
+		wxRect before = GetDrawnBounds();
+		for (std::vector<Card>::const_iterator it=cards.begin(); it!=cards.end(); ++it) {
+			wxPoint pos = NextPosition();
 			deck.push_back(*it);
+			deck.back().SetPosition(pos);
+		}
+		RecomputeBounds();
+		Changed(before);
+	}
+	
+	//moves the cards from index up off the from stack and onto this one, bottom first, or top first 
+	//if reversed (a deck turned over).  No copies of the run, one bounds update per stack:
+	void Splice(Stack& from, int index, bool reversed=false)
+	{
+		wxASSERT(&from != this);
+		int n = from.GetNumberOfCards() - index;
+		if (n <= 0) return;
+		wxRect before = GetDrawnBounds();
+		wxRect frombefore = from.GetDrawnBounds();
+		for (int i=0; i<n; i++) {
+			wxPoint pos = NextPosition();
+			deck.push_back(from.deck[reversed ? from.deck.size()-1-i : index+i]);
+			deck.back().SetPosition(pos);
 		}
+		from.deck.resize(index);
 		RecomputeBounds();
+		from.RecomputeBounds();
+		Changed(before);
+		from.Changed(frombefore);
 	}
 	
 	std::vector<Card> ExtractCards(int index)
 	{
-		std::vector<Card> stack;
-		while (index < deck.size()) {
-			stack.push_back(deck[index]);
-			std::vector<Card>::iterator it = deck.begin() + index;
-			deck.erase(it);
-		}
+		wxRect before = GetDrawnBounds();
+		std::vector<Card> stack(deck.begin() + index, deck.end());
+		deck.resize(index);
 		RecomputeBounds();
+		Changed(before);
 		return stack;
 	}
 	
 	Card ExtractTopCard()
 	{
+		wxRect before = GetDrawnBounds();
 		Card c = deck.back();
 		deck.pop_back();
 		RecomputeBounds();
+		Changed(before);
 		return c;
 	}
 
+	//moves the stack and lays its cards out again from there, at the current scale's card size
 	void SetPosition(int locx, int locy)
 	{
+		wxRect before = GetDrawnBounds();
 		bounds.x = xorig = locx;
 		bounds.y = yorig = locy;
 		for (std::vector<Card>::iterator it = deck.begin(); it !=deck.end(); ++it) {
 			if (stag) 
-				it->SetPosition(locx, locy+((it-deck.begin())*STAGGER));
+				it->SetPosition(locx, locy+((it-deck.begin())*stagger));
 			else
 				it->SetPosition(locx, locy);
+			it->Resize();
 		}
 		RecomputeBounds();
+		Changed(before);
 	}
 
 	void SetPosition(wxPoint pos)
 	{
-		bounds.x = xorig = pos.x;
-		bounds.y = yorig = pos.y;
-		for (std::vector<Card>::iterator it = deck.begin(); it !=deck.end(); ++it) {
-			if (stag) pos.y+=STAGGER;
-			it->SetPosition(pos);
-		}
-		RecomputeBounds();
+		SetPosition(pos.x, pos.y);
 	}
 	
 	void MovePosition(int dx, int dy)
 	{
+		wxRect before = GetDrawnBounds();
 		bounds.x += dx;
 		bounds.y += dy;
 		xorig += dx;
 		xorig += dy;
 		for (std::vector<Card>::iterator it = deck.begin(); it !=deck.end(); ++it) {
 			if (stag) 
-				it->SetPosition(bounds.x, bounds.y+((it-deck.begin())*STAGGER));
+				it->SetPosition(bounds.x, bounds.y+((it-deck.begin())*stagger));
 			else
 				it->SetPosition(bounds.x, bounds.y);
 		}
 		RecomputeBounds();
+		Changed(before);
 	}
 	
 	wxPoint GetPosition()
@@ -381,46 +547,77 @@ public:
 		return bounds.Contains(loc);
 	}
 
+	//the card under a point, -1 for none: the top card if they're all in one place, otherwise the one
+	//whose stagger-high strip it's in, or the top one below the strips
 	int HitTestCard(int locx, int locy)
 	{
-		if (bounds.Contains(locx, locy) & deck.size() > 0) {
-			for (unsigned i=deck.size()-1; i>=0; i--) {
-				if (deck[i].HitTest(locx, locy)) {
-					return i;
-				}
-			}
-		}
-		return -1;
+		if (!bounds.Contains(locx, locy) | deck.size() == 0) return -1;
+		int top = (int) deck.size() - 1;
+		if (!stag) return top;
+		return std::min((locy - bounds.y) / stagger, top);
 	}
 	
 	void DrawCards(wxDC& dc)
 	{
 		if (outln) {
 			dc.SetPen(*wxLIGHT_GREY_PEN);
-			dc.DrawRoundedRectangle (bounds.x,  bounds.y,  WIDTH,  HEIGHT,  3);
+			dc.DrawRoundedRectangle (bounds.x,  bounds.y,  cardwidth,  cardheight,  3);
+		}
+		if (!stag) {  //all in one place, only the top one shows
+			if (deck.size() > 0) deck.back().DrawCard(dc, facup);
+			return;
 		}
 		for (std::vector<Card>::iterator it = deck.begin(); it !=deck.end(); ++it)
 			it->DrawCard(dc, facup);
 	}
+	
+	//the area the stack has changed on screen since the last call, empty if none
+	wxRect TakeDamage()
+	{
+		wxRect d = damage;
+		damage = wxRect();
+		return d;
+	}
 
 private:
+	friend class StackBench;  //bench.cpp times RecomputeBounds
+	
 	void RecomputeBounds()
 	{
-		if (deck.size() == 0) {
-			//bounds.x = xorig;
-			//bounds.y = yorig;
-			bounds.width = WIDTH;
-			bounds.height = HEIGHT;
-		}
-		else {
-			for (std::vector<Card>::iterator it = deck.begin(); it !=deck.end(); ++it)
-				bounds.Union((*it).GetRect());
-		}
+		//cards never sit above or left of the stack position, and each sits at or below the one 
+		//under it, so the top card is the far corner:
+		bounds.width = cardwidth;
+		bounds.height = cardheight;
+		if (deck.size() > 0) bounds.Union(deck.back().GetRect());
+	}
+	
+	//where the next card added goes
+	wxPoint NextPosition()
+	{
+		if (deck.size() == 0) return GetPosition();
+		wxPoint pos = deck.back().GetPosition();
+		if (stag) pos.y += stagger;
+		return pos;
+	}
+	
+	//the area the stack draws on, empty if it draws nothing
+	wxRect GetDrawnBounds()
+	{
+		if (deck.size() == 0 & !outln) return wxRect();
+		return bounds;
+	}
+	
+	//adds the before and after areas of a change to the damage
+	void Changed(wxRect before)
+	{
+		damage.Union(before);
+		damage.Union(GetDrawnBounds());
 	}
 	
 	std::vector<Card> deck;
 	std::string name;
 	wxRect bounds;  //contains the x, y, width, height
+	wxRect damage;  //see TakeDamage
 	bool facup, outln, stag;
 	int xorig, yorig, worig, horig;
 };
@@ -486,200 +683,626 @@ private:
 };
 
 
-class CardPane: wxPanel
+/* Animation
+
+Cards in flight, any number at once, each on its own path:
+
+	- Slide: a straight line to a spot, in a set number of steps, after an optional wait; the card
+	  then lands on a stack, handed back through Advance's land.  Dealing and auto-complete.
+	- Throw: a card let go with a velocity, falling and bouncing off the bottom until it leaves by
+	  a side.  Each step draws it into the trails DC rather than invalidating where it was, so the
+	  trail builds up in a bitmap and old frames are never drawn again.  The win.
+
+Time moves in fixed FRAMEMS steps however the timer fires: Advance runs as many steps as the
+clock says are due, so a late timer event makes for a bigger jump, never a slower animation.
+A step costs the same per card wherever the card is, and the caller repaints only what
+TakeDamage hands back, so the frame time stays flat with all 52 cards in the air.
+
+*/
+
+class Animation
 {
 public:
-	CardPane(wxWindow *parent, wxWindowID id) :wxPanel(parent, id)
+	Animation()
+	{
+		ticks = 0;
+		lag = 0;
+		last = std::chrono::steady_clock::now();
+	}
+	
+	//card from where it is to to in frames steps, starting after delay steps, then onto stack
+	void Slide(const Card& card, wxPoint to, int frames, int delay, int stack, bool faceup=true)
+	{
+		Sprite s;
+		s.card = card;
+		s.from = card.GetPosition();
+		s.to = to;
+		s.frames = frames > 0 ? frames : 1;
+		s.frame = 0;
+		s.delay = delay;
+		s.stack = stack;
+		s.faceup = faceup;
+		sprites.push_back(s);
+	}
+	
+	//card off at vx, vy pixels a step, inside area until it goes out a side
+	void Throw(const Card& card, double vx, double vy, wxSize area)
+	{
+		Sprite s;
+		s.card = card;
+		s.x = card.GetX();
+		s.y = card.GetY();
+		s.vx = vx;
+		s.vy = vy;
+		s.area = area;
+		s.delay = 0;
+		s.stack = -1;
+		s.faceup = true;
+		sprites.push_back(s);
+	}
+	
+	bool IsRunning() const { return !sprites.empty(); }
+	
+	//starts the clock over, for the first Advance after a pause
+	void Restart()
+	{
+		last = std::chrono::steady_clock::now();
+		lag = 0;
+	}
+	
+	//runs the steps due by the clock, or exactly steps of them if given, for a replay that
+	//mustn't depend on timing: each calls tick(step number) and then Step
+	template<class T, class L> void Advance(T tick, L land, wxDC *trails, int steps=-1)
+	{
+		if (steps < 0) {
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			lag += std::chrono::duration<double, std::milli>(now - last).count();
+			last = now;
+			steps = (int) (lag / FRAMEMS);
+			lag -= steps * FRAMEMS;
+			if (steps > MAXSTEPS) steps = MAXSTEPS;  //after a long stall, carry on from where it was
+		}
+		for (int i=0; i<steps; i++) {
+			tick(ticks++);
+			Step(land, trails);
+		}
+	}
+	
+	//moves every card one step; slides that arrive go to land(card, stack), in the order they were
+	//added, and throws are drawn into trails, if given
+	template<class L> void Step(L land, wxDC *trails)
+	{
+		size_t kept = 0;
+		for (size_t i=0; i<sprites.size(); i++) {
+			Sprite& s = sprites[i];
+			if (s.delay > 0) {
+				s.delay--;
+				sprites[kept++] = s;
+				continue;
+			}
+			if (s.stack >= 0) {
+				damage.push_back(s.card.GetRect());
+				s.frame++;
+				if (s.frame >= s.frames) {
+					s.card.SetPosition(s.to);
+					land(s.card, s.stack);
+					continue;
+				}
+				s.card.SetPosition(s.from.x + (s.to.x - s.from.x) * s.frame / s.frames,
+					s.from.y + (s.to.y - s.from.y) * s.frame / s.frames);
+			}
+			else {
+				s.x += s.vx;
+				s.vy += GRAVITY * tablescale;
+				s.y += s.vy;
+				if (s.y + s.card.GetRect().height > s.area.GetHeight()) {
+					s.y = s.area.GetHeight() - s.card.GetRect().height;
+					s.vy = -s.vy * BOUNCE;
+				}
+				if (s.x + s.card.GetRect().width < 0 | s.x > s.area.GetWidth()) continue;  //gone
+				s.card.SetPosition((int) s.x, (int) s.y);
+				if (trails) s.card.DrawCard(*trails);
+			}
+			damage.push_back(s.card.GetRect());
+			sprites[kept++] = s;
+		}
+		sprites.resize(kept);
+	}
+	
+	//lands every slide now, in order, and drops the throws
+	template<class L> void Finish(L land)
+	{
+		for (size_t i=0; i<sprites.size(); i++) {
+			Sprite& s = sprites[i];
+			damage.push_back(s.card.GetRect());
+			if (s.stack < 0) continue;
+			s.card.SetPosition(s.to);
+			land(s.card, s.stack);
+		}
+		sprites.clear();
+	}
+	
+	void Clear()
+	{
+		sprites.clear();
+		damage.clear();
+	}
+	
+	//the cards under way that aren't leaving trails; the ones still waiting to go aren't shown
+	void Draw(wxDC& dc)
+	{
+		for (size_t i=0; i<sprites.size(); i++)
+			if (sprites[i].stack >= 0 & sprites[i].delay == 0) sprites[i].card.DrawCard(dc, sprites[i].faceup);
+	}
+	
+	//calls f(card, stack) for each slide yet to land, in landing order
+	template<class F> void ForEachLanding(F f) const
+	{
+		for (size_t i=0; i<sprites.size(); i++)
+			if (sprites[i].stack >= 0) f(sprites[i].card, sprites[i].stack);
+	}
+	
+	//calls refresh(rect) for each area the cards have changed since the last call
+	template<class R> void TakeDamage(R refresh)
+	{
+		for (size_t i=0; i<damage.size(); i++) refresh(damage[i]);
+		damage.clear();
+	}
+
+private:
+	struct Sprite
+	{
+		Card card;
+		int delay;  //steps before it starts
+		int stack;  //where a slide lands, -1 for a throw
+		bool faceup;
+		wxPoint from, to;  //slides
+		int frames, frame;
+		double x, y, vx, vy;  //throws
+		wxSize area;
+	};
+	
+	std::vector<Sprite> sprites;
+	std::vector<wxRect> damage;
+	unsigned ticks;  //steps run
+	double lag;  //milliseconds the clock is ahead of the steps
+	std::chrono::steady_clock::time_point last;
+};
+
+/* PaintStats
+
+The numbers behind the performance overlay (CardPane::renderHud), kept all the time since each
+costs a clock read or a count, and published once every HUDMS by Publish:
+
+	- paint time: OnPaint from start to end, the wxPaintDC's copy to the screen included
+	- motion latency: from the first OnMotion a paint hasn't yet shown to the end of the paint
+	  that shows it, so what a drag's card trails the pointer by, less the compositor's part
+	- paints and Refresh calls a second; more refreshes than paints is wx merging them
+	- motion events a second while dragging, against which the paints show OnMotion's coalescing
+	- allocations a paint: operator new calls over the period, on every thread, over the paints;
+	  only counted with SOLITAIRE_HUD, see allocations
+	- first frame: from launched to the end of the first paint, once for the life of the program,
+	  shown beside facesms, the part of it LoadCardFaces took
+
+*/
+
+class PaintStats
+{
+public:
+	PaintStats()
+	{
+		Start();
+		firstframe = 0;
+		painttime = paintmax = latency = latencymax = paintrate = refreshrate = motionrate = allocrate = 0;
+	}
+	
+	//begins a period, forgetting the one under way
+	void Start()
+	{
+		start = std::chrono::steady_clock::now();
+		startallocations = AllocationCount();
+		paints = refreshes = motions = latencies = 0;
+		painttotal = paintworst = latencytotal = latencyworst = 0;
+		motionwaiting = false;
+	}
+	
+	void Refreshed() { refreshes++; }
+	
+	//a motion event; only the first since the last paint starts the latency clock
+	void Moved()
+	{
+		motions++;
+		if (motionwaiting) return;
+		motion = std::chrono::steady_clock::now();
+		motionwaiting = true;
+	}
+	
+	//a paint that began at begin has just ended
+	void Painted(std::chrono::steady_clock::time_point begin)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(now - begin).count();
+		if (firstframe == 0) firstframe = std::chrono::duration<double, std::milli>(now - launched).count();
+		paints++;
+		painttotal += ms;
+		paintworst = std::max(paintworst, ms);
+		if (motionwaiting) {
+			ms = std::chrono::duration<double, std::milli>(now - motion).count();
+			latencies++;
+			latencytotal += ms;
+			latencyworst = std::max(latencyworst, ms);
+			motionwaiting = false;
+		}
+	}
+	
+	//turns the period's counts into the numbers shown, and starts the next
+	void Publish()
+	{
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (seconds <= 0) return;
+		painttime = paints ? painttotal / paints : 0;
+		paintmax = paintworst;
+		latency = latencies ? latencytotal / latencies : 0;
+		latencymax = latencyworst;
+		paintrate = paints / seconds;
+		refreshrate = refreshes / seconds;
+		motionrate = motions / seconds;
+		allocrate = paints ? (double) (AllocationCount() - startallocations) / paints : 0;
+		Start();
+	}
+	
+	//the last period's numbers, milliseconds and per second:
+	double painttime, paintmax, latency, latencymax, paintrate, refreshrate, motionrate, allocrate;
+	double firstframe;  //milliseconds, 0 until the first paint ends
+
+private:
+	std::chrono::steady_clock::time_point start, motion;
+	unsigned long long startallocations;
+	unsigned paints, refreshes, motions, latencies;
+	double painttotal, paintworst, latencytotal, latencyworst;
+	bool motionwaiting;  //a motion event not painted yet
+};
+
+
+class CardPane: public wxPanel
+{
+public:
+	CardPane(wxWindow *parent, wxWindowID id) :wxPanel(parent, id), 
+		hints([this](const Hint& h) { CallAfter([this, h]() { OnHint(h); }); }),  //answers come on the engine's thread
+		cascaderandom(0)
 	{
 		originstack = NULL;
+		origin = -1;
+		LoadCardFaces();
 		//SetBackgroundColour(wxColour(34, 139, 34)); //forest green
 		SetBackgroundColour(wxColour(34, 100, 34));
 		SetDoubleBuffered(true);
 		
-		//for each stack in the game:
-		deck.SetName("deck"); deck.SetPosition(50,100); deck.SetFaceup(false); //deck.SetCapacity(52);
-		play.SetName("play"); play.SetPosition(150,100); 
-		suit1.SetName("suit1"); suit1.SetPosition(350,100); 
-		suit2.SetName("suit2"); suit2.SetPosition(450,100); 
-		suit3.SetName("suit3"); suit3.SetPosition(550,100); 
-		suit4.SetName("suit4"); suit4.SetPosition(650,100); 
-		pile1.SetName("pile1"); pile1.SetPosition(50-PILEOFFSET,250-PILEOFFSET); pile1.SetFaceup(false); 
-		pile2.SetName("pile2"); pile2.SetPosition(150-PILEOFFSET,250-PILEOFFSET); pile2.SetFaceup(false); 
-		pile3.SetName("pile3"); pile3.SetPosition(250-PILEOFFSET,250-PILEOFFSET); pile3.SetFaceup(false); 
-		pile4.SetName("pile4"); pile4.SetPosition(350-PILEOFFSET,250-PILEOFFSET); pile4.SetFaceup(false); 
-		pile5.SetName("pile5"); pile5.SetPosition(450-PILEOFFSET,250-PILEOFFSET); pile5.SetFaceup(false); 
-		pile6.SetName("pile6"); pile6.SetPosition(550-PILEOFFSET,250-PILEOFFSET); pile6.SetFaceup(false); 
-		pile7.SetName("pile7"); pile7.SetPosition(650-PILEOFFSET,250-PILEOFFSET); pile7.SetFaceup(false); 
-		tableau1.SetName("tableau1"); tableau1.SetPosition(50,250); tableau1.SetStaggered(true); 
-		tableau2.SetName("tableau2"); tableau2.SetPosition(150,250); tableau2.SetStaggered(true); 
-		tableau3.SetName("tableau3"); tableau3.SetPosition(250,250); tableau3.SetStaggered(true); 
-		tableau4.SetName("tableau4"); tableau4.SetPosition(350,250); tableau4.SetStaggered(true); 
-		tableau5.SetName("tableau5"); tableau5.SetPosition(450,250); tableau5.SetStaggered(true); 
-		tableau6.SetName("tableau6"); tableau6.SetPosition(550,250); tableau6.SetStaggered(true); 
-		tableau7.SetName("tableau7"); tableau7.SetPosition(650,250); tableau7.SetStaggered(true); 
+		//each stack in the game, from the variant's table; the ids are klondike.h's.  The window is
+		//Klondike only, on purpose: hints, Check Deal, autocomplete, saved games and statistics all run
+		//the Klondike engine.  The other tables in rules.h are played by solitaire-sim --variant.
+		variant = &klondikevariant;
+		stock = -1;
+		for (int col=0; col<MAXCOLUMNS; col++) layout[0][col] = layout[1][col] = -1;
+		for (int s=0; s<variant->numstacks; s++) {
+			const StackRule& rule = variant->rules[s];
+			if (rule.kind == STACK_STOCK) stock = s;
+			if (rule.kind != STACK_HIDDEN) layout[rule.row][rule.column] = s;
+			stacks[s].SetName(rule.name);
+			stacks[s].SetFaceup(rule.kind != STACK_STOCK & rule.kind != STACK_HIDDEN);
+			stacks[s].SetStaggered(rule.staggered);
+		}
 		
 		movestack.SetPosition(0,0); movestack.SetOutline(false); movestack.SetStaggered(true); 
 		moving = false;
-		nullstack.SetName("nullstack");
+		tablecached = false;
 		
-		animate = false;
-		nextcard = 0;
+		cascading = trails = false;
+		cascadenext = 0;
 		win = false;  //used to keep the deal following a win from counting as a loss.
 		
-		newgame1 = myButton(this, "New Game (Draw 1)", wxPoint(1,1));
-		wxSize s1 = newgame1.GetSize();
-		newgame3 = myButton(this, "New Game (Draw 3)", wxPoint(s1.GetWidth()+2,1));
+		basefont = GetFont();
+		SetTableScale(1);  //until the first size event fits it to the window
+		LayOut();
 		
 		wins = 0;
 		losses = 0;
+		numberofcardstodraw = 0;  //no game yet, so the first deal starts the count
+		dealnumber = 0;
+		hintjob = 0;
+		checkjob = 0;
+		checkstop = false;
+		hint.job = 0;
+		hint.kind = HINT_NONE;
+		hintwanted = hintshown = false;
+		unsaved = 0;
+		savequeued = false;
+		movecount = 0;
+		gamestart = std::chrono::steady_clock::now();
+		hud = false;
+		dealbitmaps = bitmapsmade;
 		
 		Bind(wxEVT_PAINT, &CardPane::OnPaint, this);
 		Bind(wxEVT_LEFT_DCLICK, &CardPane::OnLeftDoubleClick, this);
 		Bind(wxEVT_LEFT_DOWN, &CardPane::OnLeftDown, this);
 		Bind(wxEVT_MOTION, &CardPane::OnMotion, this);
 		Bind(wxEVT_LEFT_UP, &CardPane::OnLeftUp, this);
+		Bind(wxEVT_SIZE, &CardPane::OnSize, this);
 
-		t.SetOwner(this);
-		Bind(wxEVT_TIMER, &CardPane::OnTimer, this);
+		animtimer.SetOwner(this, ANIMTIMER);
+		Bind(wxEVT_TIMER, &CardPane::OnAnimationTimer, this, ANIMTIMER);
+		autonext = 0;
+		
+		hudtimer.SetOwner(this, HUDTIMER);
+		Bind(wxEVT_TIMER, &CardPane::OnHudTimer, this, HUDTIMER);
+		dragpending = false;
+		dragx = dragy = 0;
+		dragtimer.SetOwner(this, DRAGTIMER);
+		Bind(wxEVT_TIMER, &CardPane::OnDragTimer, this, DRAGTIMER);
+	}
+	
+	~CardPane()
+	{
+		StopCheck();  //its answer would come to a window that's gone
+	}
+
+	//puts the stacks, buttons and text where they go at the current scale
+	void LayOut()
+	{
+		left = Scaled(LEFT);
+		column = Scaled(COLUMN);
+		toprow = Scaled(TOPROW);
+		tableaurow = Scaled(TABLEAUROW);
+		statsx = Scaled(500);
+		for (int s=0; s<variant->numstacks; s++) {
+			const StackRule& rule = variant->rules[s];
+			int x = left + rule.column*column, y = rule.row ? tableaurow : toprow;
+			if (rule.kind == STACK_HIDDEN) { x -= Scaled(PILEOFFSET); y -= Scaled(PILEOFFSET); }
+			stacks[s].SetPosition(x, y);
+		}
+		movestack.SetPosition(movestack.GetPosition());  //its cards to the new size
+		
+		SetFont(basefont.Scaled(tablescale));
+		newgame1 = myButton(this, "New Game (Draw 1)", wxPoint(1,1));
+		wxSize s1 = newgame1.GetSize();
+		newgame3 = myButton(this, "New Game (Draw 3)", wxPoint(s1.GetWidth()+2,1));
+	}
+	
+	//a resize fits the table to the window, see Rescale
+	void OnSize(wxSizeEvent& event)
+	{
+		event.Skip();
+		Rescale();
+	}
+	
+	//fits the table to the window: the largest scale step at which TABLEWIDTH by TABLEHEIGHT
+	//fits the client area.  The faces, rescaled only on a new step, and the layout change here, 
+	//in the size event, so painting never does either.  Put off while a drag is under way.
+	void Rescale()
+	{
+		if (moving) return;  //OnLeftUp calls again
+		wxSize client = GetClientSize();
+		if (client.GetWidth() <= 0 | client.GetHeight() <= 0) return;
+		double fit = std::min((double) client.GetWidth() / TABLEWIDTH, (double) client.GetHeight() / TABLEHEIGHT);
+		double scale = std::floor(fit * SCALESTEPS) / SCALESTEPS;
+		scale = std::max(MINSCALE, std::min(scale, (double) MAXSCALE));
+		if (scale == tablescale) return;
+		FinishAnimation();  //cards in flight land where they were going
+		SetTableScale(scale);
+		LayOut();
+		tablecached = false;
+		Refresh();
 	}
 
 	void OnPaint(wxPaintEvent& WXUNUSED(event))
 	{
-		wxPaintDC dc(this);
-		render(dc);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		{
+			wxPaintDC dc(this);  //double buffered, it puts the frame on the screen as it goes
+			Paint(dc, &GetUpdateRegion());
+		}
+		perf.Painted(start);
 	}
 	
-	void render(wxDC& dc)
+	//every Refresh and RefreshRect, counted for the performance overlay
+	void Refresh(bool erase=true, const wxRect *rect=NULL)
 	{
+		perf.Refreshed();
+		wxPanel::Refresh(erase, rect);
+	}
+	
+	//what OnPaint draws, into any DC: the update region, or everything if none
+	void Paint(wxDC& dc, const wxRegion *update=NULL)
+	{
+		if ((moving | trails) & tablecached) {  //dragging, or the win's trails: the table is already drawn, copy the damaged parts
+			wxMemoryDC mdc(tablelayer);
+			if (update) {
+				for (wxRegionIterator r(*update); r; ++r)
+					dc.Blit(r.GetX(), r.GetY(), r.GetW(), r.GetH(), &mdc, r.GetX(), r.GetY());
+			}
+			else dc.Blit(0, 0, tablelayer.GetWidth(), tablelayer.GetHeight(), &mdc, 0, 0);
+			renderMoving(dc);
+			renderHud(dc);
+		}
+		else render(dc, update);
+	}
+	
+	void render(wxDC& dc, const wxRegion *update=NULL)
+	{
+		renderTable(dc, update);
+		renderMoving(dc);
+		renderHud(dc);
+	}
+	
+	//the performance overlay, over everything at the bottom left, when it's on; see PaintStats
+	void renderHud(wxDC& dc)
+	{
+		if (!hud) return;
+		wxRect r = HudRect();
+		dc.SetPen(*wxTRANSPARENT_PEN);
+		dc.SetBrush(*wxBLACK_BRUSH);
+		dc.DrawRectangle(r);
+		wxColour text = dc.GetTextForeground();
+		dc.SetTextForeground(*wxWHITE);
+		wxString lines[HUDLINES] = {
+			wxString::Format("paint %.2f ms, worst %.2f", perf.painttime, perf.paintmax),
+			wxString::Format("motion to paint %.1f ms, worst %.1f", perf.latency, perf.latencymax),
+			wxString::Format("%.0f motion events/s", perf.motionrate),
+			wxString::Format("%.0f paints/s, %.0f refreshes/s", perf.paintrate, perf.refreshrate),
+			wxString::Format("%d bitmaps made since the deal", bitmapsmade - dealbitmaps),
+			COUNTALLOCATIONS ? wxString::Format("%.1f allocations a paint", perf.allocrate) : wxString("allocations a paint: n/a"),
+			wxString::Format("first frame %.0f ms, card faces %.1f", perf.firstframe, facesms)
+		};
+		for (int i=0; i<HUDLINES; i++) dc.DrawText(lines[i], r.x + Scaled(6), r.y + Scaled(4) + i*Scaled(16));
+		dc.SetTextForeground(text);
+	}
+	
+	wxRect HudRect()
+	{
+		int height = HUDLINES*Scaled(16) + Scaled(8);
+		return wxRect(Scaled(10), GetClientSize().GetHeight() - height - Scaled(10), Scaled(260), height);
+	}
+	
+	//turns the performance overlay on or off; its numbers start from the moment it's turned on
+	void ShowHud(bool show)
+	{
+		hud = show;
+		if (hud) {
+			perf.Start();
+			hudtimer.Start(HUDMS);
+		}
+		else hudtimer.Stop();
+		RefreshArea(HudRect());
+	}
+	
+	//the overlay's numbers, once a period
+	void OnHudTimer(wxTimerEvent& WXUNUSED(event))
+	{
+		perf.Publish();
+		RefreshArea(HudRect());
+	}
+	
+	//draws everything but the cards in motion; given the update region, skips the stacks that don't overlap it
+	void renderTable(wxDC& dc, const wxRegion *update=NULL)
+	{
+		for (int s=0; s<variant->numstacks; s++) {
+			if (stacks[s].GetNumberOfCards() == 0 & !ShowsEmpty(s)) continue;
+			if (update && update->Contains(stacks[s].GetBounds()) == wxOutRegion) continue;
+			stacks[s].DrawCards(dc);
+		}
 		
-		if (deck.GetNumberOfCards() > 0) deck.DrawCards(dc);
-		if (play.GetNumberOfCards() > 0) play.DrawCards(dc);
-		suit1.DrawCards(dc);
-		suit2.DrawCards(dc);
-		suit3.DrawCards(dc);
-		suit4.DrawCards(dc);
-		if (pile1.GetNumberOfCards() > 0) pile1.DrawCards(dc);
-		if (pile2.GetNumberOfCards() > 0) pile2.DrawCards(dc);
-		if (pile3.GetNumberOfCards() > 0) pile3.DrawCards(dc);
-		if (pile4.GetNumberOfCards() > 0) pile4.DrawCards(dc);
-		if (pile5.GetNumberOfCards() > 0) pile5.DrawCards(dc);
-		if (pile6.GetNumberOfCards() > 0) pile6.DrawCards(dc);
-		if (pile7.GetNumberOfCards() > 0) pile7.DrawCards(dc);
-		if (tableau1.GetNumberOfCards() > 0) tableau1.DrawCards(dc);
-		if (tableau2.GetNumberOfCards() > 0) tableau2.DrawCards(dc);
-		if (tableau3.GetNumberOfCards() > 0) tableau3.DrawCards(dc);
-		if (tableau4.GetNumberOfCards() > 0) tableau4.DrawCards(dc);
-		if (tableau5.GetNumberOfCards() > 0) tableau5.DrawCards(dc);
-		if (tableau6.GetNumberOfCards() > 0) tableau6.DrawCards(dc);
-		if (tableau7.GetNumberOfCards() > 0) tableau7.DrawCards(dc);
-		
-		movestack.DrawCards(dc);
-		
-		if (animate) animatecard.DrawCard(dc);
+		if (hintshown & hint.kind != HINT_NONE) {
+			dc.SetPen(wxPen(wxColour(255, 215, 0), 3));
+			dc.SetBrush(*wxTRANSPARENT_BRUSH);
+			dc.DrawRoundedRectangle(HintFrom(), 5);
+			dc.DrawRoundedRectangle(HintTo(), 5);
+		}
 		
 		newgame1.render(dc);
 		newgame3.render(dc);
 		
-		wxSize s = GetSize();
-		
-		dc.DrawText(wxString::Format("Draw-%d",numberofcardstodraw), 500,10);
+		dc.DrawText(wxString::Format("Draw-%d",numberofcardstodraw), statsx,Scaled(10));
 		if (wins == 1)
-			dc.DrawText(wxString::Format("%d Win",wins),  500,30);
+			dc.DrawText(wxString::Format("%d Win",wins),  statsx,Scaled(30));
 		else
-			dc.DrawText(wxString::Format("%d Wins",wins),  500,30);
+			dc.DrawText(wxString::Format("%d Wins",wins),  statsx,Scaled(30));
 		if (losses == 1)
-			dc.DrawText(wxString::Format("%d Loss",losses), 500,50);
+			dc.DrawText(wxString::Format("%d Loss",losses), statsx,Scaled(50));
 		else
-			dc.DrawText(wxString::Format("%d Losses",losses), 500,50);
+			dc.DrawText(wxString::Format("%d Losses",losses), statsx,Scaled(50));
+		if (numberofcardstodraw > 0)
+			dc.DrawText(wxString::Format("Deal %llu",(unsigned long long) dealnumber), statsx,Scaled(70));
 	}
-
 	
-	//compute the area of a rectangle
-	int rectArea(wxRect r)
+	void renderMoving(wxDC& dc)
 	{
-		return r.width * r.height;
+		movestack.DrawCards(dc);
+		anim.Draw(dc);
 	}
 	
-	Stack& HitTest(wxRect r)
+	//draws the table, minus the movestack, into tablelayer for OnPaint to copy from until the drop
+	void CacheTable()
 	{
-		//max hit area:
-		int hitarea = 0;
-		
-		//1. Store the hit area of the intersection of each static stack with the movestack: 
-		int deckarea = rectArea(deck.GetBounds().Intersect(r));
-		int playarea = rectArea(play.GetBounds().Intersect(r));
-		int suit1area = rectArea(suit1.GetBounds().Intersect(r));
-		int suit2area = rectArea(suit2.GetBounds().Intersect(r));
-		int suit3area = rectArea(suit3.GetBounds().Intersect(r));
-		int suit4area = rectArea(suit4.GetBounds().Intersect(r));
-		int tableau1area = rectArea(tableau1.GetBounds().Intersect(r));
-		int tableau2area = rectArea(tableau2.GetBounds().Intersect(r));
-		int tableau3area = rectArea(tableau3.GetBounds().Intersect(r));
-		int tableau4area = rectArea(tableau4.GetBounds().Intersect(r));
-		int tableau5area = rectArea(tableau5.GetBounds().Intersect(r));
-		int tableau6area = rectArea(tableau6.GetBounds().Intersect(r));
-		int tableau7area = rectArea(tableau7.GetBounds().Intersect(r));
-		
-		//2. Find the max of the hit areas:
-		if (deckarea > hitarea) hitarea = deckarea;
-		if (playarea > hitarea) hitarea = playarea;
-		if (suit1area > hitarea) hitarea = suit1area;
-		if (suit2area > hitarea) hitarea = suit2area;
-		if (suit3area > hitarea) hitarea = suit3area;
-		if (suit4area > hitarea) hitarea = suit4area;
-		if (tableau1area > hitarea) hitarea = tableau1area;
-		if (tableau2area > hitarea) hitarea = tableau2area;
-		if (tableau3area > hitarea) hitarea = tableau3area;
-		if (tableau4area > hitarea) hitarea = tableau4area;
-		if (tableau5area > hitarea) hitarea = tableau5area;
-		if (tableau6area > hitarea) hitarea = tableau6area;
-		if (tableau7area > hitarea) hitarea = tableau7area;
-		
-		//3. If a static stack's hitarea is greater than the max hit area, return that stack reference:
-		if (deckarea == hitarea) return deck;
-		if (playarea == hitarea) return play;
-		if (suit1area == hitarea) return suit1;
-		if (suit2area == hitarea) return suit2;
-		if (suit3area == hitarea) return suit3;
-		if (suit4area == hitarea) return suit4;
-		if (tableau1area == hitarea) return tableau1;
-		if (tableau2area == hitarea) return tableau2;
-		if (tableau3area == hitarea) return tableau3;
-		if (tableau4area == hitarea) return tableau4;
-		if (tableau5area == hitarea) return tableau5;
-		if (tableau6area == hitarea) return tableau6;
-		if (tableau7area == hitarea) return tableau7;
-		return nullstack;
-	}
-	
-	
-	Stack& HitTest(int x, int y)
-	{
-		if (deck.HitTest(x,y)) return deck;
-		if (play.HitTest(x,y)) return play;
-		if (suit1.HitTest(x,y)) return suit1;
-		if (suit2.HitTest(x,y)) return suit2;
-		if (suit3.HitTest(x,y)) return suit3;
-		if (suit4.HitTest(x,y)) return suit4;
-		if (tableau1.HitTest(x,y)) return tableau1;
-		if (tableau2.HitTest(x,y)) return tableau2;
-		if (tableau3.HitTest(x,y)) return tableau3;
-		if (tableau4.HitTest(x,y)) return tableau4;
-		if (tableau5.HitTest(x,y)) return tableau5;
-		if (tableau6.HitTest(x,y)) return tableau6;
-		if (tableau7.HitTest(x,y)) return tableau7;
-		return nullstack;
+		wxSize s = GetClientSize();
+		if (s.GetWidth() <= 0 | s.GetHeight() <= 0) return;
+		if (!tablelayer.IsOk() || tablelayer.GetSize() != s) {
+			tablelayer.Create(s.GetWidth(), s.GetHeight());
+			bitmapsmade++;
+		}
+		wxMemoryDC mdc(tablelayer);
+		mdc.SetBackground(wxBrush(GetBackgroundColour()));
+		mdc.Clear();
+		mdc.SetFont(GetFont());
+		renderTable(mdc);
+		tablecached = true;
+	}
+	
+	//invalidates just what the stacks have changed since the last call
+	void RefreshDamage()
+	{
+		for (int s=0; s<variant->numstacks; s++) RefreshArea(stacks[s].TakeDamage());
+		RefreshArea(movestack.TakeDamage());
+	}
+	
+	void RefreshArea(wxRect r)
+	{
+		if (r.IsEmpty()) return;
+		RefreshRect(r.Inflate(3));  //room for the outline pens
+	}
+	
+	//the draw, wins, losses and deal number text, redrawn when a win is counted or a game dealt
+	void RefreshStats()
+	{
+		wxClientDC dc(this);
+		wxSize s = dc.GetTextExtent(wxString::Format("Deal %llu",(unsigned long long) dealnumber));
+		s.IncTo(dc.GetTextExtent(wxString::Format("%d Losses",losses)));
+		RefreshArea(wxRect(statsx, Scaled(10), s.GetWidth()+40, Scaled(80)));
+	}
+
+	
+	//the stack under a point, from the layout: the column from x, then the row from y; -1 for none
+	int HitTest(int x, int y)
+	{
+		if (x < left) return -1;
+		int col = (x - left) / column;
+		if (col >= variant->columns | (x - left) % column >= cardwidth) return -1;  //off to the right, or between columns
+		if (y >= toprow & y < toprow + cardheight) return layout[0][col];
+		int t = layout[1][col];
+		if (t != -1 && stacks[t].HitTest(x, y)) return t;  //as far down as its cards go
+		return -1;
+	}
+	
+	//the stack a dragged rectangle lands on, -1 for none: of the ones it overlaps, the one it overlaps
+	//most, the lowest id on a tie.  Only the stacks in the columns it spans are looked at.
+	int HitTest(wxRect r)
+	{
+		int best = -1, bestarea = 0;
+		int first = std::max((r.x - left) / column, 0), last = std::min((r.GetRight() - left) / column, variant->columns - 1);
+		for (int col=first; col<=last; col++) {
+			int ids[2] = { layout[0][col], layout[1][col] };
+			for (int i=0; i<2; i++) {
+				if (ids[i] == -1) continue;
+				wxRect hit = stacks[ids[i]].GetBounds().Intersect(r);
+				int area = hit.width > 0 & hit.height > 0 ? hit.width * hit.height : 0;
+				if (area > bestarea | area == bestarea & area > 0 & ids[i] < best) {
+					best = ids[i];
+					bestarea = area;
+				}
+			}
+		}
+		return best;
 	}
 	
 	void movestackSetup(Stack& stack, int x, int y, int cardindex)
 	{
 		movestack.SetPosition(stack.GetCardPosition(cardindex));
-		movestack.AddCards(stack.ExtractCards(cardindex));
+		movestack.Splice(stack, cardindex);
 		originstack = &stack;
 		moving = true;
 		prevx = x;
 		prevy = y;
-		Refresh();
+		CacheTable();
+		RefreshDamage();
 	}
 
 	void OnLeftDown(wxMouseEvent& event)
@@ -689,93 +1312,32 @@ public:
 		int x = event.GetX();
 		int y = event.GetY();
 
-		animate = false;
+		if (trails) FinishAnimation();  //a click clears away the win, and goes on to do what it does
 		((wxFrame *) GetParent())->SetStatusText("");
+		hints.Cancel();  //the position is about to change, OnLeftUp starts it again
+		ClearHint();
+		if (animtimer.IsRunning()) {  //a click while cards are moving just lands them
+			FinishAnimation();
+			return;
+		}
 		
-		if (newgame1.HitTest(x,y)) { newgame1.SetClicked(true); Refresh(); return; }
-		if (newgame3.HitTest(x,y)) { newgame3.SetClicked(true); Refresh(); return; }
+		if (newgame1.HitTest(x,y)) { newgame1.SetClicked(true); RefreshArea(newgame1.GetBounds()); return; }
+		if (newgame3.HitTest(x,y)) { newgame3.SetClicked(true); RefreshArea(newgame3.GetBounds()); return; }
 		
-		//for each stack in the game:
-		if (deck.HitTest(x,y)) {
-			movestack.SetPosition(deck.GetPosition());
-			originstackname = deck.GetName();
-			originstack = &deck;
+		origin = HitTest(x, y);
+		if (origin != -1 && origin == stock) {  //a click, dealt with in OnLeftUp
+			movestack.SetPosition(stacks[stock].GetPosition());
+			originstack = &stacks[stock];
 			moving = true;
 			prevx = x;
 			prevy = y;
-			//printf("OnLeftDown: movestack: pos=%d,%d\n", movestack.GetPosition().x, movestack.GetPosition().y); fflush(stdout);
-			Refresh();
-		}
-		else if (play.HitTest(x,y))
-			originstackname = play.GetName();
-			movestack.SetPosition(play.GetPosition());
-			if ((cardindex = play.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(play, x, y, cardindex);
-		else if (suit1.HitTest(x,y)) {
-			originstackname = suit1.GetName();
-			movestack.SetPosition(suit1.GetPosition());
-			if ((cardindex = suit1.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(suit1, x, y, cardindex);
+			RefreshDamage();
 		}
-		else if (suit2.HitTest(x,y)) {
-			originstackname = suit2.GetName();
-			movestack.SetPosition(suit2.GetPosition());
-			if ((cardindex = suit2.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(suit2, x, y, cardindex);
-		}
-		else if (suit3.HitTest(x,y)) {
-			originstackname = suit3.GetName();
-			movestack.SetPosition(suit2.GetPosition());
-			if ((cardindex = suit3.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(suit3, x, y, cardindex);
-		}
-		else if (suit4.HitTest(x,y)) {
-			originstackname = suit4.GetName();
-			movestack.SetPosition(suit2.GetPosition());
-			if ((cardindex = suit4.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(suit4, x, y, cardindex);
-		}
-		else if (tableau1.HitTest(x,y)) {
-			originstackname = tableau1.GetName();
-			movestack.SetPosition(tableau1.GetPosition());
-			if ((cardindex = tableau1.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(tableau1, x, y, cardindex);
-		}
-		else if (tableau2.HitTest(x,y)) {
-			originstackname = tableau2.GetName();
-			movestack.SetPosition(tableau2.GetPosition());
-			if ((cardindex = tableau2.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(tableau2, x, y, cardindex);
-		}
-		else if (tableau3.HitTest(x,y)) {
-			originstackname = tableau3.GetName();
-			movestack.SetPosition(tableau3.GetPosition());
-			if ((cardindex = tableau3.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(tableau3, x, y, cardindex);
-		}
-		else if (tableau4.HitTest(x,y)) {
-			originstackname = tableau4.GetName();
-			movestack.SetPosition(tableau4.GetPosition());
-			if ((cardindex = tableau4.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(tableau4, x, y, cardindex);
-		}
-		else if (tableau5.HitTest(x,y)) {
-			originstackname = tableau5.GetName();
-			movestack.SetPosition(tableau5.GetPosition());
-			if ((cardindex = tableau5.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(tableau5, x, y, cardindex);
-		}
-		else if (tableau6.HitTest(x,y)) {
-			originstackname = tableau6.GetName();
-			movestack.SetPosition(tableau6.GetPosition());
-			if ((cardindex = tableau6.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(tableau6, x, y, cardindex);
-		}
-		else if (tableau7.HitTest(x,y)) {
-			originstackname = tableau7.GetName();
-			movestack.SetPosition(tableau7.GetPosition());
-			if ((cardindex = tableau7.HitTestCard(x,y)) > -1 ) 
-				movestackSetup(tableau7, x, y, cardindex);
+		else if (origin != -1) {
+			Stack& stack = stacks[origin];
+			movestack.SetPosition(stack.GetPosition());
+			if ((cardindex = stack.HitTestCard(x,y)) > -1 && CanGrab(origin, cardindex))
+				movestackSetup(stack, x, y, cardindex);
 		}
 	}
 	
@@ -785,98 +1347,219 @@ public:
 		int x = event.GetX();
 		int y = event.GetY();
 		
-		if (HitTest(x,y).GetName() == "nullstack") return;
-		if (HitTest(x,y).GetName() == "deck") return;
+		int s = HitTest(x, y);
+		if (s == -1 | s == stock) return;
 		
-		DoubleClickRules(HitTest(x,y));
+		DoubleClickRules(stacks[s]);
+		RefreshDamage();
+		if (!CheckWin() && !StartAutoComplete()) StartHint();
 	}
 	
+	//a drag's pointer is only noted here; ApplyDrag moves the cards to it at most once a frame, 
+	//straight away if a frame has gone by since the last move, else from dragtimer when one has.
+	//A mouse reporting 1000 times a second then costs one move and one repaint a frame, each
+	//showing where the pointer is now rather than working through a queue of where it was.
 	void OnMotion(wxMouseEvent& event)
 	{
 		//printf("Motion event...\n"); fflush(stdout);
-		wxPoint n;
-		if (moving) {
-			int x = event.GetX();
-			int y = event.GetY();
-			n.x = x - prevx;
-			n.y = y - prevy;
-			movestack.MovePosition(n.x, n.y);
-			//printf("OnMotion: movestack: pos=%d,%d\n", movestack.GetPosition().x, movestack.GetPosition().y); fflush(stdout);
-			prevx = x;
-			prevy = y;
-			Refresh();
+		if (!moving) return;
+		perf.Moved();
+		dragx = event.GetX();
+		dragy = event.GetY();
+		if (dragpending) return;  //the timer's on it
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - dragmoved).count();
+		if (ms >= FRAMEMS) ApplyDrag();
+		else {
+			dragpending = true;
+			dragtimer.Start(std::max(1, (int) (FRAMEMS - ms)), wxTIMER_ONE_SHOT);
 		}
 	}
 	
+	void OnDragTimer(wxTimerEvent& WXUNUSED(event))
+	{
+		if (dragpending & moving) ApplyDrag();
+		dragpending = false;
+	}
 	
-	void TableauLandingRules(Stack& tableau, Stack& pile)
+	//moves the movestack to the pointer as OnMotion last saw it
+	void ApplyDrag()
 	{
-		if (originstackname == tableau.GetName() & tableau.GetNumberOfCards() == 0) { //mouse click on tableau
-			if (movestack.GetNumberOfCards() > 0) {
-				tableau.AddCards(movestack.GetCards());  //put 'em back in the tableau
-			}	
-			else {
-				if (pile.GetNumberOfCards() > 0) tableau.AddCard(pile.ExtractTopCard()); //extract a new top card from the pile
-			}
-		}
-		else { //a drag from somewhere else
-			if (tableau.GetNumberOfCards() == 0 & //empty tableau and pile, 
-				pile.GetNumberOfCards() == 0 &
-				movestack.GetNumberOfCards() >= 1) { 
-				if (movestack.BottomCard().GetRankString() == "king") //only allow a king
-				{
-					tableau.AddCards(movestack.GetCards());
-					return;
-				}
-				else {
-					ReturnStack(); 
-					return;
-				}
-			}
-			if (tableau.GetNumberOfCards() > 0 & 
-				tableau.TopCard().GetRank() == movestack.BottomCard().GetRank() + 1 & 
-				tableau.TopCard().GetColor() != movestack.BottomCard().GetColor()) 
-			{
-					tableau.AddCards(movestack.GetCards());
-					return;
-			}
-			else
-			{
-				ReturnStack();
-			}
-		}
+		dragtimer.Stop();
+		dragpending = false;
+		dragmoved = std::chrono::steady_clock::now();
+		movestack.MovePosition(dragx - prevx, dragy - prevy);
+		//printf("OnMotion: movestack: pos=%d,%d\n", movestack.GetPosition().x, movestack.GetPosition().y); fflush(stdout);
+		prevx = dragx;
+		prevy = dragy;
+		RefreshDamage();
 	}
 	
-	void SuitLandingRules(Stack& suit)
+	//for rendercheck's drag pacing, which reads the overlay's numbers without the overlay
+	PaintStats& GetPaintStats()
 	{
-		if (originstackname == suit.GetName() & suit.GetNumberOfCards() == 0) { //mouse click on tableau
+		return perf;
+	}
+	
+	
+	//a drop of the movestack on stack t, by t's StackRule.  A click on an empty stack with a
+	//hidden stack under it, a pile under a tableau, turns the next card up.
+	void LandingRules(int t)
+	{
+		Stack& stack = stacks[t];
+		int hidden = variant->rules[t].hidden;
+		if (origin == t & stack.GetNumberOfCards() == 0) { //mouse click on the stack
 			if (movestack.GetNumberOfCards() > 0) {
-				suit.AddCards(movestack.GetCards());  //put 'em back in the tableau
-			}	
+				stack.Splice(movestack, 0);  //put 'em back
+			}
+			else if (hidden != -1 && stacks[hidden].GetNumberOfCards() > 0) { //extract a new top card from the pile
+				Record(MakeMove(hidden, t, 1, MOVE_FLIP));
+				stack.AddCard(stacks[hidden].ExtractTopCard());
+			}
 			return;
 		}
-		if (suit.GetNumberOfCards() == 0 & 
-			movestack.GetNumberOfCards() == 1 & 
-			movestack.BottomCard().GetRankString() == "ace") 
-		{
-			suit.AddCards(movestack.GetCards());
+		if (hidden != -1 && stack.GetNumberOfCards() == 0 & stacks[hidden].GetNumberOfCards() > 0) { //pile has to be flipped first
+			ReturnStack();
 			return;
 		}
-		if (suit.GetNumberOfCards() > 0 &movestack.GetNumberOfCards() == 1) 
+		if (movestack.GetNumberOfCards() >= 1 &&
+			RuleAccepts(variant->rules[t], stack.GetNumberOfCards(), TopCardId(stack), movestack.BottomCard().GetId(), movestack.GetNumberOfCards()))
 		{
-			if (movestack.BottomCard().GetSuit() == suit.TopCard().GetSuit() &
-				movestack.BottomCard().GetRank()-1 == suit.TopCard().GetRank())
-			{
-				suit.AddCards(movestack.GetCards());
-				return;
-			}
+			LandMovestack(stack);
+			return;
 		}
 		ReturnStack();
 	}
 	
+	//a click on the stock does what the variant's turn says.  Its one-card moves are made a run at
+	//a time, the cards going between the same two stacks turned over, and each run is logged as
+	//one move, which PlayMove turns over again: Klondike's turn is one DECK to PLAY move as ever.
+	void TurnStock()
+	{
+		Table t = CurrentTable();
+		if (!t.CanTurn()) return;
+		Move turn[MAXTURNMOVES];
+		int n = t.Turn(turn);
+		for (int i=0, j; i<n; i=j) {
+			for (j=i+1; j<n && turn[j].from == turn[i].from & turn[j].to == turn[i].to; j++) ;
+			Stack& from = stacks[turn[i].from];
+			Record(MakeMove(turn[i].from, turn[i].to, j - i));
+			stacks[turn[i].to].Splice(from, from.GetNumberOfCards() - (j - i), true);
+		}
+	}
+	
+	//whether the cards from index up can be picked up off stack s, by its StackRule
+	bool CanGrab(int s, int index)
+	{
+		const std::vector<Card>& cards = stacks[s].GetCards();
+		unsigned char ids[MAXTABLECARDS];
+		for (size_t i=0; i<cards.size(); i++) ids[i] = cards[i].GetId();
+		return RuleGrabs(variant->rules[s], ids, (int) cards.size(), index);
+	}
+	
+	//the foundations and free cells show an outline when empty, the rest nothing
+	bool ShowsEmpty(int s)
+	{
+		int kind = variant->rules[s].kind;
+		return kind == STACK_FOUNDATION | kind == STACK_CELL;
+	}
+	
+	//the cards on the foundations, all of them for a win
+	int FoundationCards()
+	{
+		int n = 0;
+		for (int s=0; s<variant->numstacks; s++)
+			if (variant->rules[s].kind == STACK_FOUNDATION) n += stacks[s].GetNumberOfCards();
+		return n;
+	}
+	
+	//the engine id of a stack's top card, NOCARD if empty:
+	unsigned char TopCardId(Stack& stack)
+	{
+		if (stack.GetNumberOfCards() == 0) return NOCARD;
+		return stack.TopCard().GetId();
+	}
+	
 	void ReturnStack() //puts the movestack back on the origin stack
 	{
-		originstack->AddCards(movestack.GetCards()); 
+		if (originstack) originstack->Splice(movestack, 0); 
+	}
+	
+	//a successful drop: the movestack onto its new stack, logged for undo
+	void LandMovestack(Stack& to)
+	{
+		if (&to != originstack)  //dropped back where it came from isn't a move
+			Record(MakeMove(StackId(originstack), StackId(&to), movestack.GetNumberOfCards()));
+		to.Splice(movestack, 0);
+	}
+	
+	//the engine id of one of the table's stacks, see stacks
+	int StackId(Stack *stack)
+	{
+		for (int s=0; s<variant->numstacks; s++)
+			if (&stacks[s] == stack) return s;
+		return -1;
+	}
+	
+	//logs a move made on the table; making a new one drops whatever could have been redone
+	void Record(Move m)
+	{
+		undolog.push_back(m);
+		redolog.clear();
+		movecount++;
+		Moved();
+	}
+	
+	//counts a change to the table, and every SAVEMOVES of them saves the game once the move is done
+	void Moved()
+	{
+		if (++unsaved >= SAVEMOVES & !savequeued) {
+			savequeued = true;
+			CallAfter([this]() { SaveGame(); });
+		}
+	}
+	
+	//takes back the last move, by making its inverse
+	void Undo()
+	{
+		if (animtimer.IsRunning()) FinishAnimation();
+		wxFrame *frame = (wxFrame *) GetParent();
+		if (moving | win) return;
+		if (undolog.empty()) {
+			frame->SetStatusText("Nothing to undo.");
+			return;
+		}
+		hints.Cancel();
+		ClearHint();
+		Move m = undolog.back();
+		undolog.pop_back();
+		redolog.push_back(m);
+		PlayMove(Inverse(m));
+		if (movecount > 0) movecount--;  //Redo counts it again; none before a resumed game
+		Moved();
+		RefreshDamage();
+		frame->SetStatusText(wxString::Format("Undone, %d more to undo.", (int) undolog.size()));
+		StartHint();
+	}
+	
+	void Redo()
+	{
+		wxFrame *frame = (wxFrame *) GetParent();
+		if (moving | win | animtimer.IsRunning()) return;
+		if (redolog.empty()) {
+			frame->SetStatusText("Nothing to redo.");
+			return;
+		}
+		hints.Cancel();
+		ClearHint();
+		Move m = redolog.back();
+		redolog.pop_back();
+		undolog.push_back(m);
+		PlayMove(m);
+		movecount++;
+		Moved();
+		RefreshDamage();
+		frame->SetStatusText(wxString::Format("Redone, %d more to redo.", (int) redolog.size()));
+		if (!CheckWin()) StartHint();
 	}
 	
 	void OnLeftUp(wxMouseEvent& event)
@@ -885,127 +1568,108 @@ public:
 		int x = event.GetX();
 		int y = event.GetY();
 		
-		if (!moving) {
+		if (moving) {  //the drop goes where the pointer is, however recently it moved
+			dragx = x;
+			dragy = y;
+			ApplyDrag();
+		}
+		else {
 			if (newgame1.HitTest(x,y)) { OnNewGame(1); newgame1.SetClicked(false); Refresh(); return; }
 			if (newgame3.HitTest(x,y)) { OnNewGame(3); newgame3.SetClicked(false); Refresh(); return; }
 		}
 		
-		//printf("Hit stack: %s Origin stack: %s\n", HitTest(movestack.GetBounds()).GetName().c_str(), originstackname.c_str()); fflush(stdout);
-		
-		std::string hitstack = HitTest(movestack.GetBounds()).GetName();
+		int target = HitTest(movestack.GetBounds());
 		
-		//for each stack in the game:
-		if (deck.HitTest(x,y)) {
-			if (originstackname == deck.GetName()) { //deck is clicked
-				if (deck.GetNumberOfCards() > 0) {
-					for (unsigned i=1; i<=numberofcardstodraw; i++) {
-						if (deck.GetNumberOfCards() > 0) play.AddCard(deck.ExtractTopCard());
-					}
-				}
-				else {
-					while (play.GetNumberOfCards() > 0) 
-						deck.AddCard(play.ExtractTopCard());
-					play.ClearCards();
-				}
-			}
+		int hit = HitTest(x,y);
+		if (hit != -1 && hit == stock) {
+			if (origin == stock) TurnStock();  //the stock is clicked
 			else ReturnStack();
 		}
-		else if (hitstack == "play") {
-			originstack->AddCards(movestack.GetCards()); //put 'em back where they came from...
-		}
-		
-		else if (hitstack == "suit1") {
-			SuitLandingRules(suit1);
-		}
-		else if (hitstack == "suit2") {
-			SuitLandingRules(suit2);
-		}
-		else if (hitstack == "suit3") {
-			SuitLandingRules(suit3);
-		}
-		else if (hitstack == "suit4") {
-			SuitLandingRules(suit4);
-		}
-			
-		else if (hitstack == "tableau1") {
-			TableauLandingRules(tableau1, pile1);
-		}
-		else if (hitstack == "tableau2") {
-			TableauLandingRules(tableau2, pile2);
-		}
-		else if (hitstack == "tableau3") {
-			TableauLandingRules(tableau3, pile3);
-		}
-		else if (hitstack == "tableau4") {
-			TableauLandingRules(tableau4, pile4);
-		}
-		else if (hitstack == "tableau5") {
-			TableauLandingRules(tableau5, pile5);
-		}
-		else if (hitstack == "tableau6") {
-			TableauLandingRules(tableau6, pile6);
-		}
-		else if (hitstack == "tableau7") {
-			TableauLandingRules(tableau7, pile7);
-		}
-		
+		else if (target != -1 && variant->rules[target].build != BUILD_NONE)
+			LandingRules(target);
 		else 
-			ReturnStack(); //put them back where they came from...
+			ReturnStack(); //put them back where they came from, the play stack included
 		
 		movestack.ClearCards();
 		
-		Refresh();
-			
+		origin = -1;
 		moving =  false;
-		CheckWin();
-		Refresh();
+		tablecached = false;
+		Rescale();  //a resize put off by the drag
+		if (!CheckWin() && !StartAutoComplete()) StartHint();
+		RefreshDamage();
 	}
 	
 
 	void DoubleClickRules(Stack& stack)
 	{
-		Card& stackcard = stack.TopCard();
+		if (stack.GetNumberOfCards() == 0) return;
+		unsigned char card = stack.TopCard().GetId();
 		
-		if (stackcard.GetRankString() == "ace") {
-			if (suit1.GetNumberOfCards() == 0) suit1.AddCard(stack.ExtractTopCard());
-			else if (suit2.GetNumberOfCards() == 0) suit2.AddCard(stack.ExtractTopCard());
-			else if (suit3.GetNumberOfCards() == 0) suit3.AddCard(stack.ExtractTopCard());
-			else if (suit4.GetNumberOfCards() == 0) suit4.AddCard(stack.ExtractTopCard());
-			return;
+		//first foundation that takes the card, aces go to the first empty one:
+		for (int s=0; s<variant->numstacks; s++) {
+			if (variant->rules[s].kind != STACK_FOUNDATION | &stacks[s] == &stack) continue;
+			if (RuleAccepts(variant->rules[s], stacks[s].GetNumberOfCards(), TopCardId(stacks[s]), card, 1)) {
+				Record(MakeMove(StackId(&stack), s, 1));
+				stacks[s].AddCard(stack.ExtractTopCard());
+				return;
+			}
 		}
-		
-		if (suit1.GetNumberOfCards() > 0)
-			if (stackcard.GetSuit() == suit1.TopCard().GetSuit() & stackcard.GetRank()-1 == suit1.TopCard().GetRank()) 
-				suit1.AddCard(stack.ExtractTopCard());
-		else if (suit2.GetNumberOfCards() > 0)
-			if (stackcard.GetSuit() == suit2.TopCard().GetSuit() & stackcard.GetRank()-1 == suit2.TopCard().GetRank()) 
-				suit2.AddCard(stack.ExtractTopCard());
-		else if (suit3.GetNumberOfCards() > 0)
-			if (stackcard.GetSuit() == suit3.TopCard().GetSuit() & stackcard.GetRank()-1 == suit3.TopCard().GetRank()) 
-				suit3.AddCard(stack.ExtractTopCard());
-		else if (suit4.GetNumberOfCards() > 0)
-			if (stackcard.GetSuit() == suit4.TopCard().GetSuit() & stackcard.GetRank()-1 == suit4.TopCard().GetRank()) 
-				suit4.AddCard(stack.ExtractTopCard());
-		
-		//originstackname = std::string();
 	}
 
 	void OnNewGame(int draw)
 	{
 		if (draw == 1) {
 			NewGame(1);
-			((wxFrame *) GetParent())->SetStatusText("New 1-card-draw game dealt.");
+			((wxFrame *) GetParent())->SetStatusText(wxString::Format("New 1-card-draw game dealt, deal %llu.", (unsigned long long) dealnumber));
 		}
 		else if (draw == 3) {
 			NewGame(3);
-			((wxFrame *) GetParent())->SetStatusText("New 3-card-draw game dealt.");
+			((wxFrame *) GetParent())->SetStatusText(wxString::Format("New 3-card-draw game dealt, deal %llu.", (unsigned long long) dealnumber));
 		}
 	}
+	
+	//asks for a deal number and deals it, with the current draw (draw 1 before the first game):
+	void PlayDeal()
+	{
+		wxString text = wxGetTextFromUser("Deal number:", "Play Deal", 
+			wxString::Format("%llu", (unsigned long long) dealnumber), this);
+		if (text.IsEmpty()) return;
+		std::string digits = text.Trim().Trim(false).ToStdString();
+		char *end;
+		errno = 0;
+		unsigned long long number = strtoull(digits.c_str(), &end, 10);
+		if (digits.empty() || !isdigit((unsigned char) digits[0]) | *end != '\0' | errno == ERANGE) {  //all digits, and in range
+			wxMessageBox("A deal number is a whole number, 0 to 18446744073709551615.", "Play Deal", wxOK | wxICON_ERROR, this);
+			return;
+		}
+		int draw = numberofcardstodraw > 0 ? numberofcardstodraw : 1;
+		NewGame(draw, number);
+		((wxFrame *) GetParent())->SetStatusText(wxString::Format("Deal %llu dealt, %d-card draw.", number, draw));
+	}
 
 	void NewGame(int numcarddraw)
 	{
+		NewGame(numcarddraw, RandomDealNumber());
+	}
+
+	void NewGame(int numcarddraw, uint64_t number)
+	{
+		StopCheck();  //it was checking the deal going away
+		if (!win) RecordGame(HISTORY_LOST);
+		ClearHint();
+		animtimer.Stop();
+		anim.Clear();
+		autoplay.clear();
+		autonext = 0;
+		if (trails) Refresh();
+		cascading = trails = false;
+		undolog.clear();
+		redolog.clear();
 		ClearGame();
-		ShuffleDeck();
+		dealnumber = number;
+		unsigned char shuffled[NUMCARDS];
+		ShuffleDeck(shuffled);
 		
 		if (numberofcardstodraw != numcarddraw) {
 			wins = 0;
@@ -1017,213 +1681,580 @@ public:
 		win = false;
 		
 		numberofcardstodraw = numcarddraw;
-		animate = false;
+		gamestart = std::chrono::steady_clock::now();
+		movecount = 0;
+		dealbitmaps = bitmapsmade;
 		
 		//DeckDebug();
 		
-		tableau1.AddCard(deck.ExtractTopCard());
-		pile2.AddCard(deck.ExtractTopCard());
-		pile3.AddCard(deck.ExtractTopCard());
-		pile4.AddCard(deck.ExtractTopCard());
-		pile5.AddCard(deck.ExtractTopCard());
-		pile6.AddCard(deck.ExtractTopCard());
-		pile7.AddCard(deck.ExtractTopCard());
-		
-		tableau2.AddCard(deck.ExtractTopCard());
-		pile3.AddCard(deck.ExtractTopCard());
-		pile4.AddCard(deck.ExtractTopCard());
-		pile5.AddCard(deck.ExtractTopCard());
-		pile6.AddCard(deck.ExtractTopCard());
-		pile7.AddCard(deck.ExtractTopCard());
-		
-		tableau3.AddCard(deck.ExtractTopCard());
-		pile4.AddCard(deck.ExtractTopCard());
-		pile5.AddCard(deck.ExtractTopCard());
-		pile6.AddCard(deck.ExtractTopCard());
-		pile7.AddCard(deck.ExtractTopCard());
-		
-		tableau4.AddCard(deck.ExtractTopCard());
-		pile5.AddCard(deck.ExtractTopCard());
-		pile6.AddCard(deck.ExtractTopCard());
-		pile7.AddCard(deck.ExtractTopCard());
-		
-		tableau5.AddCard(deck.ExtractTopCard());
-		pile6.AddCard(deck.ExtractTopCard());
-		pile7.AddCard(deck.ExtractTopCard());
-		
-		tableau6.AddCard(deck.ExtractTopCard());
-		pile7.AddCard(deck.ExtractTopCard());
-		
-		tableau7.AddCard(deck.ExtractTopCard());
+		int decodes = facedecodes;
+		deal.Deal(shuffled, numcarddraw);
+		LoadPosition(deal);
+		AnimateDeal();
+		RefreshStats();
+		StartHint();
+		SaveGame();
+		wxASSERT_MSG(facedecodes == decodes, "dealing shouldn't decode card images");
+		wxUnusedVar(decodes);  //when asserts are compiled out
 		
 		//StackDebug();
 		
 	}
 	
+	//rebuilds the table from an engine position:
+	void LoadPosition(const Klondike& k)
+	{
+		for (int s=0; s<NUMSTACKS; s++) {
+			std::vector<Card> cards;
+			const unsigned char *ids = k.GetCards(s);
+			for (int i=0; i<k.GetNumberOfCards(s); i++)
+				cards.push_back(Card(ids[i], stacks[s].GetPosition()));
+			stacks[s].ClearCards();
+			stacks[s].AddCards(cards);
+		}
+		Refresh();
+	}
+	
+	//keeps the game in progress and the history of games played in dir; until this is called,
+	//nothing is written to disk
+	void UseDataDir(const wxString& dir)
+	{
+		if (!wxDirExists(dir)) wxMkdir(dir);
+		savefile = wxFileName(dir, "solitaire.save").GetFullPath().ToStdString();
+		history.Open(wxFileName(dir, "solitaire.history").GetFullPath().ToStdString());
+	}
+	
+	//writes the game out, see savegame.h; cards being dragged count as still where they came from
+	bool SaveGame()
+	{
+		savequeued = false;
+		if (savefile.empty() | numberofcardstodraw == 0) return false;
+		Snapshot s;
+		s.position = CurrentPosition();
+		int from = StackId(originstack);
+		if (moving & from != -1) {
+			unsigned char ids[STACKSIZE];
+			int n = s.position.GetNumberOfCards(from);
+			memcpy(ids, s.position.GetCards(from), n);
+			const std::vector<Card>& cards = movestack.GetCards();
+			for (unsigned i=0; i<cards.size() & n<STACKSIZE; i++) ids[n++] = cards[i].GetId();
+			s.position.SetCards(from, ids, n);
+		}
+		s.dealnumber = dealnumber;
+		s.wins = wins;
+		s.losses = losses;
+		s.won = win;
+		unsaved = 0;
+		return WriteSnapshot(savefile, s);  //refuses a table short of cards, e.g. mid win animation
+	}
+	
+	//the last save, on exit
+	void SaveOnExit()
+	{
+		if (animtimer.IsRunning()) FinishAnimation();
+		SaveGame();
+	}
+	
+	//puts the saved game back on the table, returns false if there's none to be had
+	bool ResumeGame()
+	{
+		Snapshot s;
+		if (savefile.empty() || !ReadSnapshot(savefile, s)) return false;
+		StopCheck();
+		numberofcardstodraw = s.position.GetDraw();
+		dealnumber = s.dealnumber;
+		wins = s.wins;
+		losses = s.losses;
+		win = s.won;
+		DealGame(deal, dealnumber, numberofcardstodraw);  //for Check Deal
+		LoadPosition(s.position);
+		gamestart = std::chrono::steady_clock::now();  //the time and moves recorded are this run's
+		movecount = 0;
+		RefreshStats();
+		if (!win) StartHint();
+		return true;
+	}
+	
+	//adds the game on the table, as it ends, to the history
+	void RecordGame(int result)
+	{
+		if (numberofcardstodraw == 0 | !history.IsOpen()) return;
+		GameRecord r;
+		r.time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		r.dealnumber = dealnumber;
+		r.duration = (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - gamestart).count();
+		r.moves = movecount;
+		r.draw = numberofcardstodraw;
+		r.result = result;
+		r.foundation = FoundationCards();
+		r.source = HISTORY_PLAYER;
+		history.Append(r);
+	}
+	
+	//the totals from the history, and the last week's games streamed from it
+	void ShowStatistics()
+	{
+		if (!history.IsOpen()) {
+			wxMessageBox("No game history is being kept.", "Statistics", wxOK | wxICON_INFORMATION, this);
+			return;
+		}
+		int64_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		wxString text;
+		for (int draw=1; draw<=3; draw+=2) {
+			const HistoryStats& s = history.GetStats(draw);
+			unsigned long long week = 0, weekwins = 0;
+			history.QueryTime(now - 7*24*60*60, now + 1, draw, [&](const GameRecord& r) {
+				week++;
+				if (r.result == HISTORY_WON) weekwins++;
+			});
+			text += wxString::Format("%d-card draw: %llu games, %llu won", draw, (unsigned long long) s.games, (unsigned long long) s.wins);
+			if (s.games > 0)
+				text += wxString::Format(" (%.1f%%), %.0f moves and %.0f seconds a game, %.1f cards on the suits",
+					100.0 * s.wins / s.games, (double) s.moves / s.games, s.duration / 1000.0 / s.games, (double) s.foundation / s.games);
+			text += wxString::Format("\nWinning streak %llu, best %llu.  Last 7 days: %llu games, %llu won.\n\n",
+				(unsigned long long) s.streak, (unsigned long long) s.beststreak, week, weekwins);
+		}
+		wxMessageBox(text, "Statistics", wxOK | wxICON_INFORMATION, this);
+	}
+	
+	//the table as an engine position, with the cards in flight where they'll land
+	Klondike CurrentPosition()
+	{
+		unsigned char ids[NUMSTACKS][STACKSIZE];
+		int n[NUMSTACKS];
+		for (int s=0; s<NUMSTACKS; s++) {
+			const std::vector<Card>& cards = stacks[s].GetCards();
+			for (unsigned i=0; i<cards.size(); i++) ids[s][i] = cards[i].GetId();
+			n[s] = cards.size();
+		}
+		anim.ForEachLanding([&](const Card& card, int s) { if (n[s] < STACKSIZE) ids[s][n[s]++] = card.GetId(); });
+		Klondike k;
+		k.SetDraw(numberofcardstodraw);
+		for (int s=0; s<NUMSTACKS; s++) k.SetCards(s, ids[s], n[s]);
+		return k;
+	}
+	
+	//the table as the variant's rules see it, for its callbacks
+	Table CurrentTable()
+	{
+		Table t(*variant);
+		t.SetDraw(numberofcardstodraw);
+		for (int s=0; s<variant->numstacks; s++) {
+			const std::vector<Card>& cards = stacks[s].GetCards();
+			for (unsigned i=0; i<cards.size(); i++) t.Push(s, cards[i].GetId());
+		}
+		return t;
+	}
+	
+	//sets the hint engine to work on the table as it now stands; Hint shows what it finds
+	void StartHint()
+	{
+		if (numberofcardstodraw == 0) return;  //nothing dealt
+		hintjob = hints.Start(CurrentPosition());
+	}
+	
+	//the Hint command: shows the engine's best move, now if it has one, otherwise as soon as it does
+	void ShowHint()
+	{
+		if (numberofcardstodraw == 0) {
+			((wxFrame *) GetParent())->SetStatusText("Deal a game first...");
+			return;
+		}
+		hintwanted = true;
+		if (hint.job == hintjob) OnHint(hint);
+		else ((wxFrame *) GetParent())->SetStatusText("Thinking...");
+	}
+	
+	//an answer from the hint engine, back on the UI thread
+	void OnHint(const Hint& h)
+	{
+		if (h.job != hintjob) return;  //for a position that's gone
+		if (hintshown) RefreshArea(HintFrom().Union(HintTo()));
+		hint = h;
+		if (!hintwanted) return;
+		hintshown = true;
+		wxFrame *frame = (wxFrame *) GetParent();
+		switch (hint.kind) {
+			case HINT_NONE:
+				frame->SetStatusText("No move worth making, time for a new game?");
+				return;
+			case HINT_GUESS:
+				frame->SetStatusText("Hint: the best-looking move (still thinking)...");
+				break;
+			case HINT_WINS:
+				frame->SetStatusText(wxString::Format("Hint: this move leads to a win (%lu positions searched).", hint.nodes));
+				break;
+			case HINT_LOST:
+				frame->SetStatusText(wxString::Format("The solver found no win from here (%lu positions searched), but this is the best try.", hint.nodes));
+				break;
+		}
+		RefreshArea(HintFrom().Union(HintTo()));
+	}
+	
+	void ClearHint()
+	{
+		if (hintshown) RefreshArea(HintFrom().Union(HintTo()));
+		hintshown = hintwanted = false;
+	}
+	
+	//the cards the hint moves, outlined
+	wxRect HintFrom()
+	{
+		Stack& from = stacks[hint.move.from];
+		int n = from.GetNumberOfCards();
+		if (n == 0 | hint.move.from == DECK | hint.move.count == 0 | hint.move.count > n) return wxRect(from.GetPosition(), wxSize(cardwidth, cardheight)).Inflate(2);
+		wxRect r = from.GetCards()[n - hint.move.count].GetRect();
+		return r.Union(from.GetCards()[n-1].GetRect()).Inflate(2);
+	}
+	
+	//where they go: the top card there, or the empty stack
+	wxRect HintTo()
+	{
+		Stack& to = stacks[hint.move.to];
+		if (to.GetNumberOfCards() == 0) return wxRect(to.GetPosition(), wxSize(cardwidth, cardheight)).Inflate(2);
+		return wxRect(to.GetCards().back().GetRect()).Inflate(2);
+	}
+	
+	//runs the solver on the layout NewGame dealt, on a thread of its own so the table stays live;
+	//OnChecked says what it found, unless a new deal or the window closing stopped it first
+	void CheckDeal()
+	{
+		wxFrame *frame = (wxFrame *) GetParent();
+		if (deal.GetNumberOfCards(TABLEAU1) == 0) {
+			frame->SetStatusText("Deal a game first...");
+			return;
+		}
+		StopCheck();
+		frame->SetStatusText("Checking the deal...");
+		Klondike k = deal;
+		unsigned mine = checkjob;
+		checkstop = false;
+		checker = std::thread([this, k, mine]() {
+			ParallelSolver solver(std::thread::hardware_concurrency(), CHECKNODES, CHECKMEMORY);  //every core on the one deal
+			solver.SetStop(&checkstop);
+			int result = solver.Solve(k);
+			if (checkstop) return;  //stopped, nothing to tell
+			int moves = (int) solver.GetSolution().size();
+			unsigned long nodes = solver.GetNodes();
+			CallAfter([this, mine, result, moves, nodes]() { OnChecked(mine, result, moves, nodes); });
+		});
+	}
+	
+	//stops a Check Deal under way, if any, and waits for its thread; an answer it already sent is ignored
+	void StopCheck()
+	{
+		checkjob++;
+		checkstop = true;
+		if (checker.joinable()) checker.join();
+	}
+	
+	void OnChecked(unsigned job, int result, int moves, unsigned long nodes)
+	{
+		if (job != checkjob) return;  //for a deal that's gone
+		wxFrame *frame = (wxFrame *) GetParent();
+		switch (result) {
+			case SOLVER_SOLVED:
+				frame->SetStatusText(wxString::Format("This deal can be won, in %d moves (%lu positions searched).", moves, nodes));
+				break;
+			case SOLVER_UNSOLVABLE:
+				frame->SetStatusText(wxString::Format("The solver found no way to win this deal (%lu positions searched, skipping a few kinds of move that hardly ever matter).", nodes));
+				break;
+			default:
+				frame->SetStatusText(wxString::Format("Gave up after %lu positions, no telling if this deal can be won.", nodes));
+		}
+	}
+
 	void ClearGame()
 	{
-		deck.ClearCards();
-		play.ClearCards();
-		suit1.ClearCards();
-		suit2.ClearCards();
-		suit3.ClearCards();
-		suit4.ClearCards();
-		pile1.ClearCards();
-		pile2.ClearCards();
-		pile3.ClearCards();
-		pile4.ClearCards();
-		pile5.ClearCards();
-		pile6.ClearCards();
-		pile7.ClearCards();
-		tableau1.ClearCards();
-		tableau2.ClearCards();
-		tableau3.ClearCards();
-		tableau4.ClearCards();
-		tableau5.ClearCards();
-		tableau6.ClearCards();
-		tableau7.ClearCards();
+		for (int s=0; s<variant->numstacks; s++) stacks[s].ClearCards();
 	}
 
 	void LoadDeck()
 	{
-		for (unsigned i=0; i<cardlist.size(); i++) 
-			deck.AddCard(Card(cardlist[i].image, cardlist[i].suit, cardlist[i].rankstring, cardlist[i].color, cardlist[i].rank, deck.GetPosition()));
+		for (int id=0; id<NUMCARDS; id++) 
+			stacks[DECK].AddCard(Card(id, stacks[DECK].GetPosition()));
 		Refresh();
 	}
 	
-	void ShuffleDeck()
+	//fills shuffled with card ids in deck order for the current deal number, see deal.h:
+	void ShuffleDeck(unsigned char shuffled[NUMCARDS])
 	{
-		std::array<int,52> seq {0,1,2,3,4,5,6,7,8,9,
-		10,11,12,13,14,15,16,17,18,19,
-		20,21,22,23,24,25,26,27,28,29,
-		30,31,32,33,34,35,36,37,38,39,
-		40,41,42,43,44,45,46,47,48,49,
-		50,51,
-		};
-		unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-		std::shuffle (seq.begin(), seq.end(), std::default_random_engine(seed));
-
-		for (unsigned i=0; i<cardlist.size(); i++) {
-			int j = seq[i];
-			deck.AddCard(Card(cardlist[j].image, cardlist[j].suit, cardlist[j].rankstring, 
-				cardlist[j].color, cardlist[j].rank, deck.GetPosition()));
-		}
-		Refresh();
+		ShuffleCards(dealnumber, shuffled);
+	}
+	
+	//a deal number for New Game, from the clock; kept to nine digits so it's easy to read out
+	uint64_t RandomDealNumber()
+	{
+		DealRandom r(std::chrono::system_clock::now().time_since_epoch().count());
+		return r.Next64() % 1000000000;
 	}
 
 	bool CheckWin()
 	{
-		if (suit1.GetNumberOfCards() == 13 &
-			suit2.GetNumberOfCards() == 13 &
-			suit3.GetNumberOfCards() == 13 &
-			suit4.GetNumberOfCards() == 13) {
+		if (win) return true;  //already counted
+		if (FoundationCards() == variant->decks * NUMCARDS) {
 				wins++;
+				RefreshStats();
 				win = true;
-				animate = true;
-				t.Start(20,wxTIMER_ONE_SHOT);
+				RecordGame(HISTORY_WON);
+				SaveGame();
+				StartCascade();
 				return true;
 		}
 		return false;
 	}
 
-	void OnAnimate(wxMouseEvent& event)
+	//plays out the rest of the game once Klondike::Finish can, returns true if it started
+	bool StartAutoComplete()
+	{
+		if (!autoplay.empty()) return true;  //already under way
+		if (numberofcardstodraw == 0) return false;
+		Move moves[MAXFINISH];
+		int n = CurrentPosition().Finish(moves);
+		if (n <= 0) return false;
+		hints.Cancel();
+		autoplay.assign(moves, moves+n);
+		autonext = 0;
+		Animate();
+		((wxFrame *) GetParent())->SetStatusText("Finishing the game...");
+		return true;
+	}
+	
+	//sends the cards just dealt to the piles and tableaux out from the deck again, in dealing order
+	void AnimateDeal()
 	{
-		animate = true;
-		t.Start(20,wxTIMER_ONE_SHOT);
+		Card dealt[NUMCARDS];
+		int stack[NUMCARDS], n = 0;
+		for (int row=0; row<7; row++)  //the order of Klondike::Deal
+			for (int col=row; col<7; col++, n++) {
+				stack[n] = col == row ? TABLEAU1+col : PILE1+col;
+				dealt[n] = stacks[stack[n]].GetCards()[col == row ? 0 : row];
+			}
+		for (int s=PILE1; s<=TABLEAU7; s++) stacks[s].ClearCards();
+		for (int i=0; i<n; i++)
+			anim.Slide(Card(dealt[i].GetId(), stacks[DECK].GetPosition()), dealt[i].GetPosition(), DEALFRAMES, i*DEALGAP, 
+				stack[i], IsTableau(stack[i]));
+		Animate();
+	}
+	
+	//the win: the cards leave the suit stacks one at a time and bounce off across the table, 
+	//leaving trails, until a click
+	void StartCascade()
+	{
+		CacheTable();
+		if (!tablecached) return;
+		cascading = trails = true;
+		cascadenext = 0;
+		cascaderandom = DealRandom(dealnumber);  //the same deal always goes the same way
+		Animate();
+	}
+	
+	//throws the next suit stack's top card, taking the stacks in turn, and draws what's left of that
+	//stack into the trails
+	void LaunchCascade(wxDC& dc)
+	{
+		for (int i=0; i<4; i++) {
+			Stack& suit = stacks[SUIT1 + (cascadenext + i) % 4];
+			if (suit.GetNumberOfCards() == 0) continue;
+			cascadenext = (cascadenext + i + 1) % 4;
+			Card card = suit.ExtractTopCard();
+			dc.SetPen(*wxTRANSPARENT_PEN);
+			dc.SetBrush(wxBrush(GetBackgroundColour()));
+			dc.DrawRectangle(card.GetRect());
+			suit.DrawCards(dc);
+			double vx = (2 + cascaderandom.Next32() % 7) * (cascaderandom.Next32() & 1 ? 1 : -1);
+			double vy = -(double) (cascaderandom.Next32() % 12);
+			anim.Throw(card, vx * tablescale, vy * tablescale, GetClientSize());
+			return;
+		}
+		cascading = false;  //all gone
 	}
 	
-	void OnTimer(wxTimerEvent& event)
+	//keeps the animation timer going while there's anything to animate
+	void Animate()
 	{
-		if (!animate) return;
-
-		if (nextcard == 0) {  //starting...
-			nextcard++;
-			if (suit1.GetNumberOfCards() > 0) animatecard = suit1.ExtractTopCard();
-			animatecard.vert = -15;
-			animatecard.horiz = 10;
-			oddeven = true;
+		if (animtimer.IsRunning()) return;
+		anim.Restart();
+		animtimer.Start(FRAMEMS);
+	}
+	
+	//one timer event: the steps due, launching auto-complete moves and cascade cards on their steps, 
+	//then one refresh of everything they changed
+	void OnAnimationTimer(wxTimerEvent& WXUNUSED(event))
+	{
+		StepAnimation();
+	}
+	
+	//runs the animation steps due, or exactly steps of them (see Animation::Advance), with the 
+	//launches, landings and trails they bring
+	void StepAnimation(int steps=-1)
+	{
+		wxMemoryDC mdc;
+		if (trails) mdc.SelectObject(tablelayer);
+		anim.Advance(
+			[this, &mdc](unsigned step) {
+				if (autonext < autoplay.size() & step % LAUNCHFRAMES == 0) LaunchNext();
+				if (cascading & step % CASCADEGAP == 0) LaunchCascade(mdc);
+			},
+			[this](const Card& card, int stack) { stacks[stack].AddCard(card); },
+			trails ? &mdc : NULL, steps);
+		mdc.SelectObject(wxNullBitmap);
+		
+		anim.TakeDamage([this](const wxRect& r) { RefreshArea(r); });
+		RefreshDamage();
+		if (!anim.IsRunning() & autonext == autoplay.size() & !cascading) {
+			animtimer.Stop();
+			if (!autoplay.empty()) {
+				autoplay.clear();
+				autonext = 0;
+				CheckWin();
+			}
 		}
-		else {
-			int w, h;
-			GetSize(&w, &h);
-			wxPoint cp = animatecard.GetPosition();
-			if (cp.x > w | cp.y > h | cp.x < 0 | cp.y < 0) {
-				if (suit1.GetNumberOfCards() > 0) {
-					animatecard = suit1.ExtractTopCard();
-				}
-				else if (suit2.GetNumberOfCards() > 0) {
-					animatecard = suit2.ExtractTopCard();
-				}
-				else if (suit3.GetNumberOfCards() > 0) {
-					animatecard = suit3.ExtractTopCard();
-				}
-				else if (suit4.GetNumberOfCards() > 0) {
-					animatecard = suit4.ExtractTopCard();
-				}
-				else {
-					animate = 0 ;
-					return;
-				}
-				animatecard.vert = -15;
-				if (oddeven)
-					animatecard.horiz = -10;
-				else
-					animatecard.horiz = 10;
-				oddeven = !oddeven;
+	}
+	
+	//plays the next autoplay moves: flips and deck turns at once, up to and including one card sent flying
+	void LaunchNext()
+	{
+		while (autonext < autoplay.size()) {
+			Move m = autoplay[autonext++];
+			Record(m);
+			if (!IsSuit(m.to)) {
+				PlayMove(m);
+				continue;
 			}
-
-			wxPoint p = animatecard.GetPosition();
-			animatecard.SetPosition(p.x + animatecard.horiz, p.y + animatecard.vert);
-			animatecard.vert += 2;
+			anim.Slide(stacks[m.from].ExtractTopCard(), stacks[m.to].GetPosition(), FLIGHTFRAMES, 0, m.to);  //suit stacks don't stagger
+			return;
 		}
-		t.Start(20,wxTIMER_ONE_SHOT);
-		Refresh();
+	}
+	
+	//lands everything in the air, plays the rest of an auto-complete straight away, and clears away a win
+	void FinishAnimation()
+	{
+		animtimer.Stop();
+		anim.Finish([this](const Card& card, int stack) { stacks[stack].AddCard(card); });
+		anim.TakeDamage([this](const wxRect& r) { RefreshArea(r); });
+		if (trails) Refresh();
+		cascading = trails = false;
+		bool completing = !autoplay.empty();
+		while (autonext < autoplay.size()) {
+			Record(autoplay[autonext]);
+			PlayMove(autoplay[autonext++]);
+		}
+		autoplay.clear();
+		autonext = 0;
+		RefreshDamage();
+		if (completing) CheckWin();
+	}
+	
+	//an engine move, made on the stacks
+	void PlayMove(Move m)
+	{
+		Stack& from = stacks[m.from];
+		if (m.from == DECK | m.to == DECK)  //turned over, one card at a time
+			stacks[m.to].Splice(from, from.GetNumberOfCards() - m.count, true);
+		else
+			stacks[m.to].Splice(from, from.GetNumberOfCards() - m.count);
 	}
 
 private:
-	Stack deck, movestack;
-	
-	Stack play, 
-		suit1, suit2, suit3, 
-		suit4, pile1, pile2, pile3, pile4, pile5, pile6, pile7, 
-		tableau1, tableau2, tableau3, tableau4, tableau5, tableau6, tableau7,
-		nullstack;
+	Stack movestack;
+	
+	const Variant *variant;  //the game's rules and layout, see rules.h
+	int stock;  //the variant's STACK_STOCK stack, -1 for none
+	Stack stacks[MAXTABLESTACKS];  //indexed by the variant's stack id, klondike.h's
+	int layout[2][MAXCOLUMNS];  //the stack in each row and column, -1 for none; not the hidden ones, which sit under another
+	int left, column, toprow, tableaurow, statsx;  //the layout's pixels at tablescale, see LayOut
+	wxFont basefont;  //the font at scale 1
+	Klondike deal;  //the layout as dealt, for the solver
 		
-	Stack* originstack;
-	std::string originstackname;
-	int prevx, prevy;
-	bool moving, animate, oddeven, win;
+	Stack* originstack;  //where the movestack's cards came from
+	int origin;  //the stack id pressed on, -1 for none
+	int prevx, prevy;  //the pointer where the movestack was last moved to follow it
+	int dragx, dragy;  //the pointer as last seen, see OnMotion
+	bool dragpending;  //dragtimer will move the movestack
+	wxTimer dragtimer;
+	std::chrono::steady_clock::time_point dragmoved;  //when ApplyDrag last ran
+	bool moving, win;
+	
+	wxBitmap tablelayer;  //see CacheTable
+	bool tablecached;
+	
+	HintEngine hints;
+	unsigned hintjob;  //the engine's job for the table as it stands
+	std::thread checker;  //Check Deal's solver, see CheckDeal
+	std::atomic<bool> checkstop;
+	unsigned checkjob;  //bumped by StopCheck, so a stopped check's answer is ignored
+	Hint hint;  //its latest answer
+	bool hintwanted, hintshown;  //asked for with Hint, drawn on the table
 	
 	int numberofcardstodraw;
 	int wins, losses;
-	
-	wxTimer t;
-	Card animatecard;
-	int nextcard;
+	uint64_t dealnumber;  //the deal on the table, see deal.h
+	
+	//the deal, auto-complete and the win, see Animation:
+	Animation anim;
+	wxTimer animtimer;
+	std::vector<Move> autoplay;  //auto-complete's moves to the win
+	size_t autonext;  //the next one to play
+	bool cascading;  //throwing cards off the suit stacks
+	bool trails;  //the win's trails are on the table, drawn into tablelayer
+	int cascadenext;  //the suit stack to throw from next
+	DealRandom cascaderandom;
+	
+	std::vector<Move> undolog, redolog;  //the moves made since the deal, and the ones undone
+	int unsaved;  //changes to the table since the last save
+	bool savequeued;
+	std::string savefile;  //see UseDataDir
+	
+	GameHistory history;
+	std::chrono::steady_clock::time_point gamestart;
+	unsigned movecount;  //moves made since the deal, less the ones undone
 
 	myButton newgame1, newgame3;
 	
+	PaintStats perf;  //see renderHud
+	wxTimer hudtimer;
+	bool hud;  //the performance overlay is on
+	int dealbitmaps;  //bitmapsmade at the deal
 };
 
 enum {
 	Minimal_Quit = wxID_EXIT,
-	Minimal_About = wxID_ABOUT
+	Minimal_About = wxID_ABOUT,
+	Minimal_CheckDeal = wxID_HIGHEST+1,
+	Minimal_PlayDeal,
+	Minimal_Hint,
+	Minimal_Statistics,
+	Minimal_Performance,
+	Minimal_Undo = wxID_UNDO,
+	Minimal_Redo = wxID_REDO
 };
 
 class MyFrame : public wxFrame
 {
 public:
-	MyFrame(const wxString& title): wxFrame(NULL, wxID_ANY, title, wxDefaultPosition, wxSize(850,700))
+	MyFrame(const wxString& title): wxFrame(NULL, wxID_ANY, title, wxDefaultPosition, wxDefaultSize)
 	{
+		SetSize(FromDIP(wxSize(850,700)));  //the table at the screen's scale, 1 at 96 DPI; CardPane fits itself to what's there
 
 		wxMenu *fileMenu = new wxMenu;
 
+		wxMenu *editMenu = new wxMenu;
+		editMenu->Append(Minimal_Undo, "&Undo\tCtrl-Z", "Take back the last move");
+		editMenu->Append(Minimal_Redo, "&Redo\tCtrl-Y", "Make the move taken back again");
+
 		wxMenu *helpMenu = new wxMenu;
 		helpMenu->Append(Minimal_About, "&About\tF1", "Show about dialog");
+		helpMenu->AppendCheckItem(Minimal_Performance, "&Performance Overlay\tF12", "Show what drawing the table costs, for reporting a slow game");
+		fileMenu->Append(Minimal_Hint, "&Hint\tF2", "Show a good next move");
+		fileMenu->Append(Minimal_PlayDeal, "&Play Deal Number...\tCtrl-D", "Deal a game by its number");
+		fileMenu->Append(Minimal_Statistics, "&Statistics\tF3", "Show totals over all the games played");
+		fileMenu->Append(Minimal_CheckDeal, "&Check Deal\tF5", "Find out if the current deal can be won");
 		fileMenu->Append(Minimal_Quit, "E&xit\tAlt-X", "Quit solitaire");
 
 		wxMenuBar *menuBar = new wxMenuBar();
 		menuBar->Append(fileMenu, "&File");
+		menuBar->Append(editMenu, "&Edit");
 		menuBar->Append(helpMenu, "&Help");
 
 		SetMenuBar(menuBar);
@@ -1232,7 +2263,11 @@ public:
 		//cardpane->NewGame(3);
 
 		CreateStatusBar();
-		SetStatusText("Welcome to solitaire! Deal a new game with the buttons at top-left...");
+		cardpane->UseDataDir(wxStandardPaths::Get().GetUserDataDir());
+		if (cardpane->ResumeGame())
+			SetStatusText("Welcome back! Your last game is as you left it.");
+		else
+			SetStatusText("Welcome to solitaire! Deal a new game with the buttons at top-left...");
 
 	}
 	
@@ -1241,6 +2276,47 @@ public:
 		Close(true);
 	}
 	
+	void OnClose(wxCloseEvent& event)
+	{
+		cardpane->SaveOnExit();
+		event.Skip();
+	}
+	
+	void OnCheckDeal(wxCommandEvent& WXUNUSED(event))
+	{
+		cardpane->CheckDeal();
+	}
+	
+	void OnPlayDeal(wxCommandEvent& WXUNUSED(event))
+	{
+		cardpane->PlayDeal();
+	}
+	
+	void OnHint(wxCommandEvent& WXUNUSED(event))
+	{
+		cardpane->ShowHint();
+	}
+	
+	void OnStatistics(wxCommandEvent& WXUNUSED(event))
+	{
+		cardpane->ShowStatistics();
+	}
+	
+	void OnPerformance(wxCommandEvent& event)
+	{
+		cardpane->ShowHud(event.IsChecked());
+	}
+	
+	void OnUndo(wxCommandEvent& WXUNUSED(event))
+	{
+		cardpane->Undo();
+	}
+	
+	void OnRedo(wxCommandEvent& WXUNUSED(event))
+	{
+		cardpane->Redo();
+	}
+	
 	void OnAbout(wxCommandEvent& WXUNUSED(event))
 	{
 		wxMessageBox(wxT("This is a minimal Solitaire program.\n\nSource Code \u00A9 2021 Glenn Butcher, GPL 3.0 license, https://github.com/butcherg/solitaire.\nCard Deck \u00A9 2018 Howard Yeh, MIT license, https://github.com/hayeah/playing-cards-assets."),
@@ -1256,7 +2332,15 @@ private:
 
 wxBEGIN_EVENT_TABLE(MyFrame, wxFrame)
     EVT_MENU(Minimal_Quit,  MyFrame::OnQuit)
+    EVT_CLOSE(MyFrame::OnClose)
     EVT_MENU(Minimal_About, MyFrame::OnAbout)
+    EVT_MENU(Minimal_CheckDeal, MyFrame::OnCheckDeal)
+    EVT_MENU(Minimal_PlayDeal, MyFrame::OnPlayDeal)
+    EVT_MENU(Minimal_Hint, MyFrame::OnHint)
+    EVT_MENU(Minimal_Statistics, MyFrame::OnStatistics)
+    EVT_MENU(Minimal_Performance, MyFrame::OnPerformance)
+    EVT_MENU(Minimal_Undo, MyFrame::OnUndo)
+    EVT_MENU(Minimal_Redo, MyFrame::OnRedo)
 wxEND_EVENT_TABLE()
 
 
@@ -1273,8 +2357,18 @@ public:
 		frame->Show(true);
 		return true;
 	}
+	
+	int OnExit()
+	{
+		cardfaces.clear();  //every bitmap and image, before wx shuts down the graphics system
+		facecache.clear();
+		cardimages.clear();
+		return wxApp::OnExit();
+	}
 };
 
+#ifndef SOLITAIRE_BENCH  //bench.cpp brings its own app
 wxIMPLEMENT_APP(MyApp);
+#endif
 
 
@@ -0,0 +1,200 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/* solitaire-solve
+
+Batch solver: runs the solver over a range of deal numbers (see deal.h) on every core and
+writes one CSV line per deal:
+
+	deal,draw,result,nodes,usec,moves
+
+result is solved, unsolvable (no win among the moves the solver searches, see solver.h) or
+unknown (the node or memory budget ran out), moves is the solution length.  Results are
+flushed to the file every --checkpoint seconds.  Running the same command again after the
+process was killed picks up where it left off: deals already in the file for the same draw are
+skipped, and a half-written last line is cut off the file.
+
+	solitaire-solve --deals 1-1000000 --draw 3 --out draw3.csv
+
+A single deal, --deal N, is searched by all the threads together (see ParallelSolver in
+solver.h), for the one hard deal someone asks about; its node and memory budgets are the
+whole run's, --memory times the threads.
+
+	solitaire-solve --deal 48213907 --draw 3 --out hard.csv
+
+*/
+
+#include "klondike.h"
+#include "solver.h"
+#include "deal.h"
+#include "workpool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <unistd.h>  //ftruncate
+
+void usage()
+{
+	fprintf(stderr,
+		"usage: solitaire-solve --deals FIRST-LAST [options]\n"
+		"       solitaire-solve --deal N [options]\n"
+		"  --draw 1|3          cards drawn from the deck (default 1)\n"
+		"  --threads N         worker threads (default: all cores)\n"
+		"  --nodes N           solver node budget per deal (default 5000000)\n"
+		"  --memory MB         solver table size per thread (default 256)\n"
+		"  --out FILE          results file (default solve-draw<N>.csv)\n"
+		"  --checkpoint SECS   how often results are flushed to the file (default 10)\n");
+	exit(1);
+}
+
+const char *resultnames[] = { "solved", "unsolvable", "unknown" };
+
+//deals in [first, last] already recorded in the results file for this draw; returns the offset
+//the last whole line ends at, where a line half-written by a kill starts
+long LoadDone(const char *filename, int draw, uint64_t first, uint64_t last, std::vector<bool>& done)
+{
+	FILE *f = fopen(filename, "rb");
+	if (!f) return 0;
+	char line[256];
+	long whole = 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (line[strlen(line)-1] != '\n') break;  //killed mid-line
+		whole = ftell(f);
+		unsigned long long deal;
+		int d;
+		char result[32];
+		if (sscanf(line, "%llu,%d,%31[a-z],", &deal, &d, result) != 3) continue;
+		if (d == draw & deal >= first & deal <= last) done[deal - first] = true;
+	}
+	fclose(f);
+	return whole;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long first = 0, last = 0;
+	bool deals = false;
+	int draw = 1;
+	int threads = std::thread::hardware_concurrency();
+	unsigned long nodes = 5000000;
+	size_t memory = 256;
+	double checkpoint = 10;
+	std::string filename;
+
+	for (int i=1; i<argc; i++) {
+		std::string arg = argv[i];
+		if (i+1 == argc) usage();
+		const char *val = argv[++i];
+		if (arg == "--deals") deals = sscanf(val, "%llu-%llu", &first, &last) == 2 && first <= last && last - first < (1ULL << 40) && last != ~0ULL;
+		else if (arg == "--deal") {
+			deals = sscanf(val, "%llu", &first) == 1 && first != ~0ULL;
+			last = first;
+		}
+		else if (arg == "--draw") draw = atoi(val);
+		else if (arg == "--threads") threads = atoi(val);
+		else if (arg == "--nodes") nodes = strtoul(val, NULL, 10);
+		else if (arg == "--memory") memory = strtoul(val, NULL, 10);
+		else if (arg == "--out") filename = val;
+		else if (arg == "--checkpoint") checkpoint = atof(val);
+		else usage();
+	}
+	if (!deals | (draw != 1 & draw != 3)) usage();
+	if (threads < 1) threads = 1;
+	if (filename.empty()) filename = "solve-draw" + std::to_string(draw) + ".csv";
+
+	uint64_t count = last - first + 1;
+	std::vector<bool> done(count, false);
+	long whole = LoadDone(filename.c_str(), draw, first, last, done);
+	uint64_t skipped = 0;
+	for (uint64_t i=0; i<count; i++) if (done[i]) skipped++;
+
+	FILE *out = fopen(filename.c_str(), "a+b");
+	if (!out) {
+		fprintf(stderr, "solitaire-solve: can't open %s\n", filename.c_str());
+		return 1;
+	}
+	fseek(out, 0, SEEK_END);
+	long size = ftell(out);
+	if (size > whole) {  //a line cut short by a kill, gone so the deal is solved again
+		if (ftruncate(fileno(out), whole) != 0) {
+			fprintf(stderr, "solitaire-solve: can't cut the half-written line off %s\n", filename.c_str());
+			return 1;
+		}
+		fseek(out, 0, SEEK_END);
+		size = whole;
+	}
+	if (size == 0)
+		fprintf(out, "deal,draw,result,nodes,usec,moves\n");
+	fflush(out);
+	if (skipped) fprintf(stderr, "resuming, %llu of %llu deals already done\n", (unsigned long long) skipped, (unsigned long long) count);
+
+	std::vector<Solver> solvers(threads, Solver(nodes, memory*1024*1024));
+	bool single = count == 1 & threads > 1;  //one deal: every thread on it
+	ParallelSolver parallel(threads, nodes, memory*threads*1024*1024);
+	std::mutex lock;  //guards everything below
+	std::string pending;
+	uint64_t finished = skipped, tally[3] = {0,0,0}, totalnodes = 0;
+	typedef std::chrono::steady_clock clock;
+	clock::time_point start = clock::now(), lastflush = start;
+
+	WorkPool pool;
+	pool.Run(first, last + 1, single ? 1 : threads, [&](int t, uint64_t deal) {
+		if (done[deal - first]) return;
+
+		Klondike k;
+		DealGame(k, deal, draw);
+
+		clock::time_point t0 = clock::now();
+		int result = single ? parallel.Solve(k) : solvers[t].Solve(k);
+		long long usec = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - t0).count();
+		unsigned long searched = single ? parallel.GetNodes() : solvers[t].GetNodes();
+		int moves = result != SOLVER_SOLVED ? 0 : (int) (single ? parallel.GetSolution() : solvers[t].GetSolution()).size();
+
+		char line[128];
+		snprintf(line, sizeof(line), "%llu,%d,%s,%lu,%lld,%d\n", (unsigned long long) deal, draw, resultnames[result],
+			searched, usec, moves);
+
+		std::lock_guard<std::mutex> guard(lock);
+		pending += line;
+		finished++;
+		tally[result]++;
+		totalnodes += searched;
+		clock::time_point now = clock::now();
+		if (std::chrono::duration<double>(now - lastflush).count() >= checkpoint) {
+			fputs(pending.c_str(), out);
+			fflush(out);
+			pending.clear();
+			lastflush = now;
+			double elapsed = std::chrono::duration<double>(now - start).count();
+			fprintf(stderr, "%llu/%llu deals, %.1f deals/s\n", (unsigned long long) finished,
+				(unsigned long long) count, (finished - skipped) / elapsed);
+		}
+	});
+	fputs(pending.c_str(), out);
+	fclose(out);
+
+	double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	uint64_t solved = tally[SOLVER_SOLVED], decided = solved + tally[SOLVER_UNSOLVABLE];
+	printf("draw %d, deals %llu-%llu: %llu solved, %llu unsolvable, %llu unknown", draw, first, last,
+		(unsigned long long) solved, (unsigned long long) tally[SOLVER_UNSOLVABLE], (unsigned long long) tally[SOLVER_UNKNOWN]);
+	if (decided) printf(", %.2f%% of decided deals winnable", 100.0 * solved / decided);
+	printf("\n%.1fs on %d threads, %.0f nodes/s\n", elapsed, threads, totalnodes / elapsed);
+	return 0;
+}
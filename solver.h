@@ -0,0 +1,645 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SOLVER__
+#define __SOLVER__
+
+#include "klondike.h"
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+
+/* Solver
+
+Answers "can this position be won?" for a Klondike position, by depth-first search over the
+moves GenerateMoves lists.  What keeps the search small:
+
+	- a transposition table of every position already visited, keyed by a 64-bit hash of
+	  the position with interchangeable things folded together: suit stacks are keyed by
+	  suit rather than by slot, and columns with no pile left are sorted.  A position seen
+	  before is either on the current path or already lost, so it is never searched twice.
+	- forced moves: a pile flip onto its empty tableau costs nothing, and a card that no
+	  tableau card could ever need is sent to its suit stack ("foundation-safe").  When
+	  either is available it is the only move tried.
+	- pointless moves are skipped: a king that already sits on an empty column, a partial
+	  run whose move uncovers nothing useful, and a card taken back down from a suit stack
+	  that nothing could then be built on.  Of the rest, moves that uncover the biggest
+	  piles are tried first.  Only the first of these is provably safe (see IsUseful); the
+	  other two almost never cost a win but could, so SOLVER_UNSOLVABLE means no win was
+	  found among the moves searched, not a proof that there is none.
+	- once the deck, play and piles are all empty the game is won; the remaining cards are
+	  played off to the suit stacks without searching.
+
+The search gives up, returning SOLVER_UNKNOWN, after maxnodes positions, when the table, sized
+to maxmemory bytes, is three-quarters full, or when another thread sets the SetStop flag.
+
+ParallelSolver, further down, puts every core on one position, for a single hard deal.
+
+*/
+
+enum {
+	SOLVER_SOLVED,
+	SOLVER_UNSOLVABLE,
+	SOLVER_UNKNOWN
+};
+
+inline uint64_t HashMix(uint64_t h)
+{
+	h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+//hash of a position, the same for positions that only differ in ways that don't matter to the game
+inline uint64_t PositionKey(const Klondike& k)
+{
+	uint64_t h = 14695981039346656037ULL;  //FNV-1a offset basis
+
+	//how far each suit is built, whichever suit stack it's in:
+	unsigned char built[4] = {0,0,0,0};
+	for (int s=SUIT1; s<=SUIT4; s++)
+		if (k.GetNumberOfCards(s) > 0) built[CardSuit(k.TopCard(s))] = k.GetNumberOfCards(s);
+	for (int i=0; i<4; i++) h = (h ^ built[i]) * 1099511628211ULL;
+
+	for (int s=DECK; s<=PLAY; s++) {
+		const unsigned char *c = k.GetCards(s);
+		for (int i=0; i<k.GetNumberOfCards(s); i++) h = (h ^ c[i]) * 1099511628211ULL;
+		h = (h ^ 0xfe) * 1099511628211ULL;
+	}
+
+	//a column with a pile is tied to its place by the pile's cards; without one it can be anywhere:
+	uint64_t columns[7];
+	for (int t=0; t<7; t++) {
+		int pile = k.GetNumberOfCards(PILE1+t);
+		uint64_t c = pile ? (t+1)*16 + pile : 0;
+		const unsigned char *cards = k.GetCards(TABLEAU1+t);
+		for (int i=0; i<k.GetNumberOfCards(TABLEAU1+t); i++) c = (c ^ cards[i]) * 1099511628211ULL;
+		columns[t] = HashMix(c);
+	}
+	std::sort(columns, columns+7);
+	for (int t=0; t<7; t++) h = HashMix(h ^ columns[t]);
+	return h;
+}
+
+//open-addressed set of position keys; 0 marks an empty slot
+class PositionTable
+{
+public:
+	PositionTable()
+	{
+		mask = 0;
+		used = 0;
+	}
+
+	void Reset(size_t maxmemory)
+	{
+		size_t slots = 1024;
+		while (slots * 2 * sizeof(uint64_t) <= maxmemory) slots *= 2;
+		if (slots != keys.size()) keys.assign(slots, 0);
+		else std::fill(keys.begin(), keys.end(), 0);
+		mask = slots - 1;
+		used = 0;
+	}
+
+	//adds the key, false if it was already there
+	bool Insert(uint64_t key)
+	{
+		if (key == 0) key = 1;
+		size_t i = key & mask;
+		while (keys[i] != 0) {
+			if (keys[i] == key) return false;
+			i = (i + 1) & mask;
+		}
+		keys[i] = key;
+		used++;
+		return true;
+	}
+
+	bool IsFull()
+	{
+		return used * 4 >= keys.size() * 3;
+	}
+
+	size_t GetMemory()
+	{
+		return keys.size() * sizeof(uint64_t);
+	}
+
+private:
+	std::vector<uint64_t> keys;
+	size_t mask, used;
+};
+
+class Solver
+{
+public:
+	Solver(unsigned long maxnodes=5000000, size_t maxmemory=256*1024*1024)
+	{
+		nodelimit = maxnodes;
+		memorylimit = maxmemory;
+		nodes = 0;
+		stop = NULL;
+	}
+
+	//a flag another thread can set to end a Solve early, NULL for none
+	void SetStop(const std::atomic<bool> *flag)
+	{
+		stop = flag;
+	}
+
+	void SetNodeLimit(unsigned long maxnodes)
+	{
+		nodelimit = maxnodes;
+	}
+
+	//searches from start, returns one of SOLVER_SOLVED, SOLVER_UNSOLVABLE or SOLVER_UNKNOWN
+	int Solve(const Klondike& start)
+	{
+		k = start;
+		nodes = 0;
+		path.clear();
+		solution.clear();
+		moves.clear();
+		frames.clear();
+		table.Reset(memorylimit);
+
+		table.Insert(PositionKey(k));
+		PushFrame();
+		while (!frames.empty()) {
+			if (IsCleared()) {
+				solution = path;
+				PlayOff(solution);
+				return SOLVER_SOLVED;
+			}
+
+			Frame& f = frames.back();
+			if (f.next == f.end) {
+				moves.resize(f.begin);
+				frames.pop_back();
+				if (!path.empty()) {
+					k.Undo(path.back());
+					path.pop_back();
+				}
+				continue;
+			}
+
+			Move m = moves[f.next++];
+			k.Apply(m);
+			if (!table.Insert(PositionKey(k))) {
+				k.Undo(m);
+				continue;
+			}
+			if (++nodes >= nodelimit | table.IsFull()) return SOLVER_UNKNOWN;
+			if (stop && stop->load(std::memory_order_relaxed)) return SOLVER_UNKNOWN;
+			path.push_back(m);
+			PushFrame();
+		}
+		return SOLVER_UNSOLVABLE;
+	}
+
+	//moves from the start position to the win, valid after SOLVER_SOLVED
+	const std::vector<Move>& GetSolution()
+	{
+		return solution;
+	}
+
+	unsigned long GetNodes()
+	{
+		return nodes;
+	}
+
+	size_t GetMemory()
+	{
+		return table.GetMemory();
+	}
+
+private:
+	struct Frame
+	{
+		size_t begin, next, end;  //this position's moves, in the moves vector
+	};
+
+	//nothing left face-down or in the deck: every remaining card can be played off
+	bool IsCleared()
+	{
+		if (k.GetNumberOfCards(DECK) > 0 | k.GetNumberOfCards(PLAY) > 0) return false;
+		for (int p=PILE1; p<=PILE7; p++)
+			if (k.GetNumberOfCards(p) > 0) return false;
+		return true;
+	}
+
+	//the lowest card left is always on top of its column, so this never gets stuck
+	void PlayOff(std::vector<Move>& moves)
+	{
+		Klondike c = k;
+		while (!c.IsWon()) {
+			for (int t=TABLEAU1; t<=TABLEAU7; t++) {
+				if (c.GetNumberOfCards(t) == 0) continue;
+				int s = c.SuitFor(c.TopCard(t));
+				if (s == -1) continue;
+				Move m = { (unsigned char) t, (unsigned char) s, 1, 0 };
+				c.Apply(m);
+				moves.push_back(m);
+			}
+		}
+	}
+
+	//keeps the moves worth searching from the current position.
+	//
+	//A king's run moved whole from a column with no pile under it can only go to an empty
+	//column, which gives the same position with two columns swapped, and PositionKey doesn't
+	//tell those apart: skipping it loses nothing.
+	//
+	//A partial run, X and what's on it, moved from U to Y: Y takes X, so Y is U's twin, the
+	//same rank and colour in the other suit, and everything that could later be built on the
+	//uncovered U could be built on the uncovered Y instead.  The one thing the move gives that
+	//staying put doesn't is U itself: going up to its suit stack (allowed) or taking the play
+	//card (allowed, though Y could take it too).  What isn't covered is U going up later, after
+	//Y has been built on; that's rare but possible, so this rule is a pruning, not a proof.
+	//
+	//A card taken down from its suit stack is only kept if the play card or a tableau card could
+	//go on it now.  One it could take later, off the deck, is missed the same way.
+	bool IsUseful(Move m)
+	{
+		if (IsTableau(m.from) & IsTableau(m.to)) {
+			int n = k.GetNumberOfCards(m.from);
+			if (m.count == n) {  //a whole column: only if it frees a pile, or a non-king leaves a space for a king
+				if (k.GetNumberOfCards(m.from - TABLEAU1 + PILE1) > 0) return true;
+				return CardRank(k.GetCards(m.from)[0]) != 13;
+			}
+			//part of a column: only if the card uncovered can go up, or take the play card
+			unsigned char under = k.GetCards(m.from)[n - m.count - 1];
+			if (k.SuitFor(under) != -1) return true;
+			return k.GetNumberOfCards(PLAY) > 0 && TableauAccepts(under, k.TopCard(PLAY));
+		}
+		if (IsSuit(m.from)) {  //taking a card back down: only if something can then go on it
+			unsigned char card = k.TopCard(m.from);
+			if (k.GetNumberOfCards(PLAY) > 0 && TableauAccepts(card, k.TopCard(PLAY))) return true;
+			for (int t=TABLEAU1; t<=TABLEAU7; t++)
+				for (int i=0; i<k.GetNumberOfCards(t); i++)
+					if (t != m.to && TableauAccepts(card, k.GetCards(t)[i])) return true;
+			return false;
+		}
+		return true;
+	}
+
+	//search order: uncover the biggest piles first
+	int Priority(Move m)
+	{
+		if (IsTableau(m.from) && m.count == k.GetNumberOfCards(m.from))
+			return 1 + k.GetNumberOfCards(m.from - TABLEAU1 + PILE1);
+		return 0;
+	}
+
+	void PushFrame()
+	{
+		Move list[MAXMOVES];
+		int n = k.GenerateMoves(list);
+
+		Frame f;
+		f.begin = f.next = moves.size();
+		for (int i=0; i<n; i++) {
+			if (IsPile(list[i].from) | (IsSuit(list[i].to) && k.IsSafeUp(k.TopCard(list[i].from)))) {
+				moves.resize(f.begin);  //forced, the only move from here
+				moves.push_back(list[i]);
+				break;
+			}
+			if (IsUseful(list[i])) moves.push_back(list[i]);
+		}
+		f.end = moves.size();
+		for (size_t i=f.begin+1; i<f.end; i++) {  //insertion sort, stable, lists are short
+			Move m = moves[i];
+			int p = Priority(m);
+			size_t j = i;
+			for (; j>f.begin && Priority(moves[j-1]) < p; j--) moves[j] = moves[j-1];
+			moves[j] = m;
+		}
+		frames.push_back(f);
+	}
+
+	Klondike k;
+	PositionTable table;
+	std::vector<Move> path, solution, moves;
+	std::vector<Frame> frames;
+	unsigned long nodes, nodelimit;
+	size_t memorylimit;
+	const std::atomic<bool> *stop;
+	
+	friend class ParallelSolver;  //runs its own search loop on a Solver's moves and frames
+};
+
+/* Parallel solver
+
+One position searched by several threads at once, for the one deal someone wants an answer to
+rather than many deals, which WorkPool already spreads over the cores.
+
+The threads share SharedPositionTable, the transposition table with its slots claimed by
+compare-and-swap and no lock.  The thread that claims a position searches everything under it,
+and the others pass it by, just as a single search passes by a position it has seen.  No
+subtree is searched twice, so "unsolvable" means what it does for Solver: no win among the moves
+IsUseful lets through.
+
+The work starts as the one position, and idle threads steal the rest: a thread with no task
+looks through the other threads' search stacks, shallowest position first, and takes the
+untried moves of the first position that has any, the biggest subtrees going, as tasks for itself
+and whoever is idle next.  The owner never stops to give work away; it only holds its own lock,
+one per thread, while it changes its stack, which the thief holds while it reads it.  A task is
+the moves from the start, so a thief plays them to get there.  The first thread to clear the
+table writes the solution and stops the rest.  The search is over when every thread is idle
+with nothing left to steal; the node and memory budgets and the SetStop flag cover all the
+threads together.
+
+Which thread gets where first depends on timing, so the node count and the solution found vary
+from run to run; the answer, solvable or not, doesn't unless a budget runs out.
+
+*/
+
+#define SOLVER_NODEBATCH 256  //positions a thread counts before adding them to the shared total
+#define SOLVER_IDLEMS 1  //how long an idle thread with nothing to steal waits before looking again
+
+//open-addressed set of position keys, safe for any number of threads inserting at once
+class SharedPositionTable
+{
+public:
+	SharedPositionTable()
+	{
+		slots = 0;
+		mask = 0;
+	}
+
+	void Reset(size_t maxmemory)
+	{
+		size_t n = 1024;
+		while (n * 2 * sizeof(uint64_t) <= maxmemory) n *= 2;
+		if (n != slots) {
+			keys.reset(new std::atomic<uint64_t>[n]);
+			slots = n;
+			mask = n - 1;
+		}
+		for (size_t i=0; i<slots; i++) keys[i].store(0, std::memory_order_relaxed);
+	}
+
+	//adds the key, false if it was already there, put there by this thread or another
+	bool Insert(uint64_t key)
+	{
+		if (key == 0) key = 1;
+		size_t i = key & mask;
+		for (;;) {
+			uint64_t there = keys[i].load(std::memory_order_relaxed);
+			if (there == 0) {
+				if (keys[i].compare_exchange_strong(there, key, std::memory_order_relaxed)) return true;
+				//another thread took the slot first; there is now what it put
+			}
+			if (there == key) return false;
+			i = (i + 1) & mask;
+		}
+	}
+
+	size_t GetSlots()
+	{
+		return slots;
+	}
+
+	size_t GetMemory()
+	{
+		return slots * sizeof(uint64_t);
+	}
+
+private:
+	std::unique_ptr<std::atomic<uint64_t>[]> keys;
+	size_t slots, mask;
+};
+
+class ParallelSolver
+{
+public:
+	ParallelSolver(int threads, unsigned long maxnodes=5000000, size_t maxmemory=256*1024*1024)
+	{
+		numthreads = threads < 1 ? 1 : threads;
+		nodelimit = maxnodes;
+		memorylimit = maxmemory;
+		stop = NULL;
+		nodes = 0;
+		finished = false;
+		solved = gaveup = false;
+		idle = 0;
+	}
+
+	//a flag another thread can set to end a Solve early, NULL for none
+	void SetStop(const std::atomic<bool> *flag)
+	{
+		stop = flag;
+	}
+
+	//searches from start on every thread, returns one of SOLVER_SOLVED, SOLVER_UNSOLVABLE or SOLVER_UNKNOWN
+	int Solve(const Klondike& start)
+	{
+		origin = start;
+		table.Reset(memorylimit);
+		table.Insert(PositionKey(start));
+		nodes = 0;
+		finished = solved = gaveup = false;
+		idle = 0;
+		solution.clear();
+		tasks.assign(1, std::vector<Move>());
+
+		workers.reset(new Worker[numthreads]);
+		std::vector<std::thread> pool;
+		for (int t=0; t<numthreads; t++)
+			pool.push_back(std::thread([this, t]() { Work(workers[t]); }));
+		for (unsigned t=0; t<pool.size(); t++) pool[t].join();
+		workers.reset();
+
+		if (solved) return SOLVER_SOLVED;  //the solution is empty for a start already won
+		return gaveup ? SOLVER_UNKNOWN : SOLVER_UNSOLVABLE;
+	}
+
+	//moves from the start position to the win, valid after SOLVER_SOLVED
+	const std::vector<Move>& GetSolution()
+	{
+		return solution;
+	}
+
+	unsigned long GetNodes()
+	{
+		return (unsigned long) nodes.load();
+	}
+
+	size_t GetMemory()
+	{
+		return table.GetMemory();
+	}
+
+private:
+	//a thread's search: its Solver's stack, and the task it's under, which the stack starts after
+	struct Worker
+	{
+		Solver s;
+		size_t base;
+		std::mutex lock;  //guards s.path, s.moves and s.frames against a thief
+	};
+
+	//one thread: takes a task, or steals some, until there's nothing left for anyone or the search is over
+	void Work(Worker& w)
+	{
+		for (;;) {
+			std::vector<Move> task;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				idle++;
+				for (;;) {
+					if (finished) return;
+					if (tasks.empty()) Steal();
+					if (!tasks.empty()) break;
+					if (idle == numthreads) {  //nobody's searching and nothing's left: searched it all
+						finished = true;
+						wake.notify_all();
+						return;
+					}
+					wake.wait_for(guard, std::chrono::milliseconds(SOLVER_IDLEMS));
+				}
+				idle--;
+				task.swap(tasks.back());
+				tasks.pop_back();
+				if (!tasks.empty()) wake.notify_one();  //more for the next idle thread
+			}
+			Search(w, task);
+		}
+	}
+
+	//with lock held: the untried moves of the shallowest position with any, on any thread's stack, as tasks
+	void Steal()
+	{
+		for (int t=0; t<numthreads; t++) {
+			Worker& v = workers[t];
+			std::lock_guard<std::mutex> guard(v.lock);
+			Solver& s = v.s;
+			for (size_t i=0; i<s.frames.size(); i++) {
+				Solver::Frame& f = s.frames[i];
+				if (f.next == f.end) continue;
+				for (size_t j=f.next; j<f.end; j++) {
+					tasks.push_back(std::vector<Move>(s.path.begin(), s.path.begin() + v.base + i));
+					tasks.back().push_back(s.moves[j]);
+				}
+				f.next = f.end;
+				return;
+			}
+		}
+	}
+
+	//searches everything under the position task leads to, Solver::Solve's loop on a shared table,
+	//taking w.lock whenever it changes the stack a thief reads
+	void Search(Worker& w, std::vector<Move>& task)
+	{
+		Solver& s = w.s;
+		s.k = origin;
+		for (size_t i=0; i<task.size(); i++) s.k.Apply(task[i]);
+		unsigned long counted = 0;
+		if (!task.empty()) {
+			if (!table.Insert(PositionKey(s.k))) return;  //got there another way
+			counted++;
+		}
+		std::unique_lock<std::mutex> guard(w.lock);
+		w.base = task.size();
+		s.path.swap(task);
+		s.moves.clear();
+		s.frames.clear();
+		s.PushFrame();
+		while (!s.frames.empty()) {
+			if (s.IsCleared()) {
+				std::vector<Move> win = s.path;
+				s.PlayOff(win);
+				guard.unlock();
+				Finish(&win);
+				guard.lock();
+				break;
+			}
+
+			Solver::Frame& f = s.frames.back();
+			if (f.next == f.end) {
+				s.moves.resize(f.begin);
+				s.frames.pop_back();
+				if (s.path.size() > w.base) {
+					s.k.Undo(s.path.back());
+					s.path.pop_back();
+				}
+				continue;
+			}
+
+			Move m = s.moves[f.next++];
+			guard.unlock();
+			s.k.Apply(m);
+			if (!table.Insert(PositionKey(s.k))) {
+				s.k.Undo(m);
+				guard.lock();
+				continue;
+			}
+			if (++counted == SOLVER_NODEBATCH) {
+				unsigned long total = nodes.fetch_add(counted, std::memory_order_relaxed) + counted;
+				counted = 0;
+				//each thread may be a batch short of counting, so a table filled to 3/4 less that is full:
+				if (total >= nodelimit | (total + numthreads * SOLVER_NODEBATCH) * 4 >= table.GetSlots() * 3
+						| (stop && stop->load(std::memory_order_relaxed)))
+					Finish(NULL);
+			}
+			guard.lock();
+			if (finished.load(std::memory_order_relaxed)) break;
+			s.path.push_back(m);
+			s.PushFrame();
+		}
+		s.frames.clear();  //nothing here for a thief now
+		nodes.fetch_add(counted, std::memory_order_relaxed);
+	}
+
+	//ends the search for every thread, with the winning moves, or NULL for a budget run out; the first to call decides
+	void Finish(const std::vector<Move> *win)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (finished) return;
+		if (win) {
+			solution = *win;
+			solved = true;
+		}
+		else gaveup = true;
+		finished = true;
+		wake.notify_all();
+	}
+
+	Klondike origin;
+	SharedPositionTable table;
+	int numthreads;
+	unsigned long nodelimit;
+	size_t memorylimit;
+	const std::atomic<bool> *stop;
+
+	std::unique_ptr<Worker[]> workers;  //one a thread, for the length of a Solve
+	std::atomic<unsigned long> nodes;
+	std::atomic<bool> finished;  //a win found, a budget run out, or nothing left to search
+	bool solved, gaveup;  //a win was found, or a budget ran out or stop was set; set by Finish, read after the threads are done
+	std::mutex lock;  //guards tasks, idle, solution and the wait on wake; taken before any Worker's lock
+	std::condition_variable wake;
+	int idle;  //threads with no task, out of numthreads
+	std::vector<std::vector<Move> > tasks;  //each the moves from the start to a position nobody has claimed
+	std::vector<Move> solution;
+};
+
+#endif
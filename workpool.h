@@ -0,0 +1,106 @@
+/*
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __WORKPOOL__
+#define __WORKPOOL__
+
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+/* WorkPool
+
+Runs a job for every number in a range across a set of threads.  Each thread starts with an
+equal slice and works through it from the front; a thread that runs out steals the back half
+of whichever slice has the most left.  Deals vary from microseconds to the whole node budget,
+so stealing keeps every core busy until the last few jobs.
+
+*/
+
+class WorkPool
+{
+public:
+	//calls work(thread, i) for every i in [first, last), thread being 0..threads-1
+	template<class F> void Run(uint64_t first, uint64_t last, int threads, F work)
+	{
+		if (threads < 1) threads = 1;
+		slices = std::vector<Slice>(threads);
+		uint64_t n = last > first ? last - first : 0;
+		for (int t=0; t<threads; t++) {
+			slices[t].next = first + n * t / threads;
+			slices[t].end = first + n * (t+1) / threads;
+		}
+
+		std::vector<std::thread> pool;
+		for (int t=0; t<threads; t++)
+			pool.push_back(std::thread([this, t, &work]() {
+				uint64_t i;
+				while (Take(t, i) || Steal(t, i)) work(t, i);
+			}));
+		for (unsigned t=0; t<pool.size(); t++) pool[t].join();
+	}
+
+private:
+	struct Slice
+	{
+		Slice() { next = end = 0; }
+		Slice(const Slice& s) { next = s.next; end = s.end; }
+		std::mutex lock;
+		uint64_t next, end;
+	};
+
+	bool Take(int t, uint64_t& i)
+	{
+		std::lock_guard<std::mutex> guard(slices[t].lock);
+		if (slices[t].next == slices[t].end) return false;
+		i = slices[t].next++;
+		return true;
+	}
+
+	bool Steal(int t, uint64_t& i)
+	{
+		for (;;) {
+			int victim = -1;
+			uint64_t most = 0;
+			for (unsigned v=0; v<slices.size(); v++) {
+				std::lock_guard<std::mutex> guard(slices[v].lock);
+				if (slices[v].end - slices[v].next > most) {
+					most = slices[v].end - slices[v].next;
+					victim = v;
+				}
+			}
+			if (victim == -1) return false;
+
+			uint64_t from, to;
+			{
+				std::lock_guard<std::mutex> guard(slices[victim].lock);
+				if (slices[victim].next == slices[victim].end) continue;  //finished while we looked
+				to = slices[victim].end;
+				from = slices[victim].next + (to - slices[victim].next) / 2;
+				slices[victim].end = from;
+			}
+			std::lock_guard<std::mutex> guard(slices[t].lock);
+			slices[t].next = from + 1;
+			slices[t].end = to;
+			i = from;
+			return true;
+		}
+	}
+
+	std::vector<Slice> slices;
+};
+
+#endif